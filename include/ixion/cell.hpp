@@ -51,6 +51,14 @@ public:
 
     ~formula_cell();
 
+    /**
+     * Formula cell instances are allocated from a pool shared by all model
+     * contexts, which places cells created one after another close to each
+     * other in memory.
+     */
+    static void* operator new(std::size_t size);
+    static void operator delete(void* p);
+
     const formula_tokens_store_ptr_t& get_tokens() const;
     void set_tokens(const formula_tokens_store_ptr_t& tokens);
 
@@ -61,15 +69,73 @@ public:
 
     /**
      * Determine if this cell contains circular reference by walking through
-     * all its reference tokens.
+     * all its reference tokens.  A referenced formula cell is considered
+     * safe only if it has already been checked, hence the cells must be
+     * checked in their calculation order.
+     *
+     * The calculation normally detects circular references on the
+     * dependency graph built from the cell tracker.  This check only gets
+     * used for the cells whose precedents are not known to the graph, such
+     * as the cells not registered via register_formula_cell().
+     *
+     * @return true if this cell contains no circular reference, false
+     *         otherwise.
      */
-    void check_circular(const iface::formula_model_access& cxt, const abs_address_t& pos);
+    bool check_circular(const iface::formula_model_access& cxt, const abs_address_t& pos);
 
     /**
-     * Reset cell's internal state.
+     * Set the outcome of a circular reference check performed outside of
+     * this cell, such as one performed on the dependency graph of all
+     * formula cells being calculated.  A cell flagged as unsafe receives an
+     * error result, and won't get interpreted.
+     *
+     * @param safe true if this cell contains no circular reference, false
+     *             otherwise.
+     */
+    void set_circular_safe(bool safe);
+
+    /**
+     * Reset cell's internal state.  The current result, if any, is kept as
+     * the previous result of the cell until the next reset.
+     *
+     * Note that this does not notify the model that stores this cell.  The
+     * model may keep a copy of the result for fast range access, which then
+     * stays until the cell is interpreted again.  Use the overload that
+     * takes the model access for a cell stored in a model.
      */
     void reset();
 
+    /**
+     * Reset cell's internal state, and notify the model that stores this
+     * cell via formula_model_access::reset_formula_result().
+     *
+     * @param cxt model access of the model that stores this cell.
+     * @param pos position of this cell.
+     */
+    void reset(iface::formula_model_access& cxt, const abs_address_t& pos);
+
+    /**
+     * Make the result the cell had prior to the last reset() call available
+     * again, without interpreting the cell.  Use this for a cell none of
+     * whose precedents have changed since its last interpretation.
+     *
+     * @return true if the previous result has been restored, false if the
+     *         cell has no previous result, in which case it needs to be
+     *         interpreted.
+     */
+    bool restore_previous_result();
+
+    /**
+     * Check whether the result of the last interpretation differs from the
+     * result the cell had prior to the last reset() call.  Call this only
+     * after the cell has been interpreted, or has had its previous result
+     * restored, in which case the result is considered unchanged.
+     *
+     * @return true if the result has changed, or the cell had no previous
+     *         result, false otherwise.
+     */
+    bool has_result_changed() const;
+
     /**
      * Get a series of all reference tokens included in the formula
      * expression stored in this cell.
@@ -107,14 +173,41 @@ public:
      */
     formula_result get_result_cache(formula_result_wait_policy_t policy) const;
 
+    /**
+     * Get the type of the cached result as a single cell, without making a
+     * copy of the result.  For a formula cell whose result is a matrix, the
+     * type of the matrix element at the position of the cell is returned.
+     *
+     * @param policy action to take in case the result is not yet available.
+     *
+     * @return type of the result value, which is either numeric, string, or
+     *         error.
+     */
+    cell_value_t get_value_type(formula_result_wait_policy_t policy) const;
+
     /**
      * Set a cached result to this formula cell instance.
      *
+     * Note that this does not notify the model that stores this cell.  Use
+     * the overload that takes the model access for a cell stored in a
+     * model.
      *
      * @param result cached result.
      */
     void set_result_cache(formula_result result);
 
+    /**
+     * Set a cached result to this formula cell instance, and notify the
+     * model that stores this cell via
+     * formula_model_access::publish_formula_result().
+     *
+     * @param cxt model access of the model that stores this cell.
+     * @param pos position of this cell.
+     * @param result cached result.
+     */
+    void set_result_cache(
+        iface::formula_model_access& cxt, const abs_address_t& pos, formula_result result);
+
     formula_group_t get_group_properties() const;
 
     /**
@@ -37,12 +37,39 @@ public:
     dirty_cell_tracker(const dirty_cell_tracker&) = delete;
     dirty_cell_tracker& operator= (const dirty_cell_tracker&) = delete;
 
+    /**
+     * Memory used by the tracking relationships stored for one sheet.  The
+     * byte count is an estimate based on the sizes of the stored elements,
+     * and does not include the overhead of the memory allocator.
+     */
+    struct IXION_DLLPUBLIC sheet_memory_usage
+    {
+        sheet_t sheet = 0;
+
+        /** Number of directory nodes in the R-trees. */
+        size_t tree_nodes = 0;
+
+        /** Number of destination ranges stored in the R-trees. */
+        size_t tree_entries = 0;
+
+        /**
+         * Number of listeners.  A column of cells stored as a single
+         * relative listener counts as one.
+         */
+        size_t listeners = 0;
+
+        /** Estimated number of bytes used. */
+        size_t bytes = 0;
+    };
+
     dirty_cell_tracker();
     ~dirty_cell_tracker();
 
     /**
      * Add a tracking relationship from a source cell or cell range to a
-     * destination cell or cell range.
+     * destination cell or cell range.  The destination may also be a range
+     * of whole columns or whole rows, which is kept in a separate interval
+     * index instead of being expanded to the full size of the sheet.
      *
      * @param src source cell or cell range that includes reference to
      *             (therefore listens to) the range.
@@ -51,6 +78,44 @@ public:
      */
     void add(const abs_range_t& src, const abs_range_t& dest);
 
+    /**
+     * Add a tracking relationship from a column of cells to a range that
+     * each of them references relative to its own position.  All such
+     * relationships of consecutive cells in the same column that share the
+     * same relative reference, as is the case with a formula filled down
+     * across many rows, are stored as a single relative listener regardless
+     * of the number of cells.  The destination range of each cell is only
+     * computed when the tracker is queried.
+     *
+     * @param src single cell or a column of cells on one sheet that
+     *            reference the range.
+     * @param dest range referenced by each cell, relative to the position
+     *             of the cell.
+     */
+    void add_relative(const abs_range_t& src, const range_t& dest);
+
+    /**
+     * Enter bulk-load mode.  Tracking relationships added while in this
+     * mode are only collected, and get inserted all at once when
+     * end_bulk_add() is called.  This is considerably faster than adding
+     * them one at a time when there are many of them to add, for instance
+     * when all the formula cells of a newly loaded document get registered,
+     * and also results in better balanced trees.
+     *
+     * The tracker must not be queried, and no relationships may be removed
+     * while in bulk-load mode.  Doing so throws std::logic_error.
+     */
+    void begin_bulk_add();
+
+    /**
+     * Insert all the tracking relationships collected since the last
+     * begin_bulk_add() call, and leave the bulk-load mode.  The
+     * relationships that share the same destination range get grouped into
+     * a single listener, and the trees of all affected sheets get rebuilt
+     * together with their existing listeners.
+     */
+    void end_bulk_add();
+
     /**
      * Remove an existing tracking relationship from a source cell or cell
      * range to a destination cell or cell range. If no such relationship
@@ -61,6 +126,18 @@ public:
      */
     void remove(const abs_range_t& src, const abs_range_t& dest);
 
+    /**
+     * Remove an existing tracking relationship added via add_relative().
+     * The source cells may be any part of the column of cells previously
+     * added, in which case the remaining cells keep tracking the range.  If
+     * no such relationship exists, it does nothing.
+     *
+     * @param src single cell or a column of cells on one sheet.
+     * @param dest range referenced by each cell, relative to the position
+     *             of the cell.
+     */
+    void remove_relative(const abs_range_t& src, const range_t& dest);
+
     /**
      * Register a formula cell located at the specified position as volatile.
      * Note that the caller should ensure that the cell at the specified
@@ -78,10 +155,31 @@ public:
      */
     void remove_volatile(const abs_range_t& pos);
 
+    /**
+     * Check whether a formula cell is registered as volatile.
+     *
+     * @param pos position of the cell to check.
+     *
+     * @return true if the cell is registered as volatile, false otherwise.
+     */
+    bool is_volatile(const abs_range_t& pos) const;
+
     abs_range_set_t query_dirty_cells(const abs_range_t& modified_cell) const;
 
     abs_range_set_t query_dirty_cells(const abs_range_set_t& modified_cells) const;
 
+    /**
+     * Get all formula cells and formula cell groups that directly reference
+     * any cell within the specified range.  Unlike query_dirty_cells(), this
+     * method does not follow the chain of indirect dependencies.
+     *
+     * @param range cell range whose direct dependents are to be queried.
+     *
+     * @return collection of formula cell and formula cell group positions
+     *         that directly reference the range.
+     */
+    abs_range_set_t query_direct_dependents(const abs_range_t& range) const;
+
     std::vector<abs_range_t> query_and_sort_dirty_cells(const abs_range_t& modified_cell) const;
 
     std::vector<abs_range_t> query_and_sort_dirty_cells(
@@ -89,6 +187,25 @@ public:
 
     std::string to_string() const;
 
+    /**
+     * Rebuild the internal R-trees from their current content.  Removing
+     * many tracking relationships leaves the trees fragmented, which slows
+     * down the queries.  A tree gets rebuilt automatically once the number
+     * of relationships removed from it since it was last built exceeds a
+     * certain ratio of the remaining ones, so there is normally no need to
+     * call this explicitly.
+     */
+    void compact();
+
+    /**
+     * Get the memory usage of the stored tracking relationships, for each
+     * sheet up to the last one that has any.  The R-tree entries are
+     * accounted for on the sheet of their destination ranges.
+     *
+     * @return memory usage of each sheet, ordered by sheet index.
+     */
+    std::vector<sheet_memory_usage> get_memory_usage() const;
+
     bool empty() const;
 };
 
@@ -71,7 +71,10 @@ public:
     void set_formula_cell(cell_pos pos, std::string_view formula);
 
     /**
-     * Calculate all the "dirty" formula cells in the document.
+     * Calculate all the "dirty" formula cells in the document.  Only those
+     * formula cells that are affected by the cells modified since the last
+     * calculation get calculated, and the calculation does not spread
+     * beyond a formula cell whose result has not changed.
      *
      * @param thread_count number of threads to use to perform calculation.
      *                     When 0 is specified, it only uses the main thread.
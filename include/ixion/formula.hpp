@@ -157,6 +157,11 @@ IXION_DLLPUBLIC std::vector<abs_range_t> query_and_sort_dirty_cells(
  * Calculate all specified formula cells in the order they occur in the
  * sequence.
  *
+ * Circular references are detected on the dependencies of the cells
+ * registered via register_formula_cell().  When the cell tracker of the
+ * model tracks nothing at all, the references of each cell get checked
+ * against the cells preceding it in the sequence instead.
+ *
  * @param cxt model context.
  * @param formula_cells formula cells to be calculated.  The cells will be
  *                      calculated in the order they appear in the sequence.
@@ -165,13 +170,40 @@ IXION_DLLPUBLIC std::vector<abs_range_t> query_and_sort_dirty_cells(
  * @param thread_count number of calculation threads to use.  Note that
  *                     passing 0 will make the process use the main thread
  *                     only, while passing any number greater than 0 will
- *                     make the process spawn specified number of
- *                     calculation threads plus one additional thread to
- *                     manage the calculation threads.
+ *                     make the process use specified number of
+ *                     calculation threads.  When the model is a
+ *                     model_context, the calculation threads are owned by
+ *                     it and reused across calculation runs.
  */
 void IXION_DLLPUBLIC calculate_sorted_cells(
     iface::formula_model_access& cxt, const std::vector<abs_range_t>& formula_cells, size_t thread_count);
 
+/**
+ * Calculate the specified formula cells in the order they occur in the
+ * sequence, but only those whose results may have changed.  A formula cell
+ * gets interpreted if it directly references one of the modified cells,
+ * is one of the specified dirty formula cells, is volatile, or references
+ * another formula cell whose result has changed in this calculation.  All
+ * the other formula cells get their previous results restored without
+ * being interpreted, so that the calculation stops spreading as soon as the
+ * results stay the same.
+ *
+ * @param cxt model context.
+ * @param formula_cells formula cells to be calculated, typically the
+ *                      returned value from query_and_sort_dirty_cells.
+ * @param thread_count number of calculation threads to use.  See the
+ *                     other overload for the details.
+ * @param modified_cells collection of non-formula cells whose values have
+ *                       been updated, which should be the same collection
+ *                       as the one passed to query_and_sort_dirty_cells.
+ * @param dirty_formula_cells (optional) collection of formula cells that
+ *                            must be interpreted regardless, such as those
+ *                            that have been newly inserted.
+ */
+void IXION_DLLPUBLIC calculate_sorted_cells(
+    iface::formula_model_access& cxt, const std::vector<abs_range_t>& formula_cells, size_t thread_count,
+    const abs_range_set_t& modified_cells, const abs_range_set_t* dirty_formula_cells = nullptr);
+
 } // namespace ixion
 
 #endif
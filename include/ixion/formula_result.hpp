@@ -51,6 +51,13 @@ public:
     void set_error(formula_error_t e);
     void set_matrix(matrix mtx);
 
+    /**
+     * Swap the content with another instance.  No memory gets allocated.
+     *
+     * @param r instance to swap the content with.
+     */
+    void swap(formula_result& r);
+
     /**
      * Get a numeric result value.  The caller must make sure the result is of
      * numeric type, else the behavior is undefined.
@@ -37,6 +37,8 @@ IXION_DLLPUBLIC std::string_view get_opcode_name(fopcode_t oc);
  */
 IXION_DLLPUBLIC std::string_view get_formula_opcode_string(fopcode_t oc);
 
+namespace detail { class formula_program_cache; }
+
 class IXION_DLLPUBLIC formula_token
 {
     fopcode_t m_opcode;
@@ -66,6 +68,7 @@ class IXION_DLLPUBLIC formula_tokens_store
 {
     friend void intrusive_ptr_add_ref(formula_tokens_store*);
     friend void intrusive_ptr_release(formula_tokens_store*);
+    friend class detail::formula_program_cache;
 
     struct impl;
     std::unique_ptr<impl> mp_impl;
@@ -86,6 +89,15 @@ public:
 
     size_t get_reference_count() const;
 
+    /**
+     * Get mutable access to the stored tokens.  The formula cells sharing
+     * this store keep the tokens compiled into an internal form, which this
+     * method discards so that any modification to the tokens takes effect.
+     * For that reason, it must not be called while any of those formula
+     * cells is being calculated.
+     *
+     * @return reference to the stored tokens.
+     */
     formula_tokens_t& get();
     const formula_tokens_t& get() const;
 };
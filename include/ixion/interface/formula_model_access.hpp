@@ -25,6 +25,7 @@ class dirty_cell_tracker;
 class matrix;
 struct abs_address_t;
 struct abs_range_t;
+struct abs_rc_range_t;
 struct config;
 
 namespace iface {
@@ -117,6 +118,70 @@ public:
      */
     virtual matrix get_range_value(const abs_range_t& range) const = 0;
 
+    /**
+     * Walk through all cells within a range one column block at a time,
+     * instead of one cell at a time.  A column block is a series of
+     * contiguous cells of the same type within a column.  The callback gets
+     * called once for each block that overlaps with the range, from the
+     * left-most column to the right-most column, and within each column
+     * from the top to the bottom.
+     *
+     * The default implementation queries the type of each cell via
+     * get_celltype(), and groups adjacent cells of the same type into one
+     * block.  Since it has no access to the underlying storage, the data
+     * pointer of each block it passes is nullptr.
+     *
+     * @param sheet index of the sheet to walk.
+     * @param range range of cells to walk.  Unset rows or columns in the
+     *              range are expanded to cover the entire sheet.
+     * @param cb callback function to call for each column block.
+     */
+    virtual void walk(sheet_t sheet, const abs_rc_range_t& range, column_block_callback_t cb) const;
+
+    /**
+     * Pass all numeric values within a range to a callback, in order to
+     * reduce them to a single value without first storing them in a
+     * matrix.  Runs of numeric cells are passed directly from the cell
+     * storage.  Boolean values and numeric formula results are passed as
+     * numeric values via a small fixed-size buffer.  String and empty
+     * cells are skipped.
+     *
+     * The default implementation walks the range via walk(), and fetches
+     * the value of each cell individually via get_numeric_value(),
+     * get_boolean_value() and get_formula_result().  All values are passed
+     * via the buffer.
+     *
+     * @param range range of cells to fold.  Unset rows or columns in the
+     *              range are expanded to cover the entire sheet.
+     * @param cb callback function to receive arrays of numeric values.
+     *
+     * @exception ixion::formula_error if one of the formula cells in the
+     *            range has an error result.
+     */
+    virtual void fold_numeric(const abs_range_t& range, numeric_array_callback_t cb) const;
+
+    /**
+     * Receive a notification that the result of a formula cell has become
+     * available, so that the model may keep a copy of it in a form suited
+     * for fast range access.  This may be called concurrently from multiple
+     * threads for different cells.  The default implementation does
+     * nothing.
+     *
+     * @param pos position of the formula cell.
+     * @param cell formula cell whose result has become available.
+     */
+    virtual void publish_formula_result(const abs_address_t& pos, const formula_cell& cell);
+
+    /**
+     * Receive a notification that the result of a formula cell has been
+     * reset prior to its recalculation.  This is called from the thread
+     * that runs the calculation, before any worker thread starts.  The
+     * default implementation does nothing.
+     *
+     * @param pos position of the formula cell.
+     */
+    virtual void reset_formula_result(const abs_address_t& pos);
+
     /**
      * Session handler instance receives various events from the formula
      * interpretation run, in order to respond to those events.  This is
@@ -69,6 +69,19 @@ public:
     void set(size_t row, size_t col, const std::string& str);
     void set(size_t row, size_t col, formula_error_t val);
 
+    /**
+     * Set a sequence of numeric values to a column, starting at the
+     * specified position and going downward.  All values must fit within
+     * the column.
+     *
+     * @param row row position of the first value.
+     * @param col column position of the values.
+     * @param first pointer to the first value in the sequence.
+     * @param last pointer to the position past the last value in the
+     *             sequence.
+     */
+    void set(size_t row, size_t col, const double* first, const double* last);
+
     element get(size_t row, size_t col) const;
 
     size_t row_size() const;
@@ -28,6 +28,7 @@ class cell_access;
 namespace detail {
 
 class model_context_impl;
+class model_thread_pool;
 
 }
 
@@ -42,6 +43,7 @@ class IXION_DLLPUBLIC model_context : public iface::formula_model_access
 {
     friend class named_expressions_iterator;
     friend class cell_access;
+    friend class detail::model_thread_pool;
 
     std::unique_ptr<detail::model_context_impl> mp_impl;
 
@@ -112,6 +114,10 @@ public:
 
     virtual double count_range(const abs_range_t& range, const values_t& values_type) const override;
     virtual matrix get_range_value(const abs_range_t& range) const override;
+    virtual void walk(sheet_t sheet, const abs_rc_range_t& range, column_block_callback_t cb) const override;
+    virtual void fold_numeric(const abs_range_t& range, numeric_array_callback_t cb) const override;
+    virtual void publish_formula_result(const abs_address_t& pos, const formula_cell& cell) override;
+    virtual void reset_formula_result(const abs_address_t& pos) override;
     virtual std::unique_ptr<iface::session_handler> create_session_handler() override;
     virtual iface::table_handler* get_table_handler() override;
     virtual const iface::table_handler* get_table_handler() const override;
@@ -259,6 +265,15 @@ public:
      */
     void set_cell_values(sheet_t sheet, std::initializer_list<input_row> rows);
 
+    /**
+     * Register a factory to create a session handler for each formula cell
+     * interpretation.  No session handler is created while no factory is
+     * registered, which is the default.
+     *
+     * @param factory pointer to the factory instance, or nullptr to
+     *                unregister the current one.  The caller manages the
+     *                life cycle of the instance.
+     */
     void set_session_handler_factory(session_handler_factory* factory);
 
     void set_table_handler(iface::table_handler* handler);
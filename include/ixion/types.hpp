@@ -13,6 +13,7 @@
 #include <cstdlib>
 #include <cstdint>
 #include <string_view>
+#include <functional>
 
 namespace ixion {
 
@@ -123,7 +124,8 @@ enum value_t
     value_string  = 0x01,
     value_numeric = 0x02,
     value_boolean = 0x04,
-    value_empty   = 0x08
+    value_empty   = 0x08,
+    value_error   = 0x10
 };
 
 /** type that stores a mixture of value_t values. */
@@ -136,6 +138,7 @@ public:
     bool is_boolean() const { return (m_val & value_boolean) == value_boolean; }
     bool is_string() const { return (m_val & value_string) == value_string; }
     bool is_empty() const { return (m_val & value_empty) == value_empty; }
+    bool is_error() const { return (m_val & value_error) == value_error; }
 };
 
 /** Value that specifies the area inside a table. */
@@ -218,6 +221,69 @@ enum class rc_direction_t
     vertical
 };
 
+/**
+ * Type of a block of cells stored contiguously in a column.
+ */
+enum class column_block_t : int
+{
+    unknown = 0,
+    empty,
+    boolean,
+    numeric,
+    string,
+    formula
+};
+
+/**
+ * This structure describes a block of cells stored contiguously in a
+ * column, and is passed to the callback during a column block walk.
+ */
+struct IXION_DLLPUBLIC column_block_shape_t
+{
+    /** Row position of the first cell in the block. */
+    std::size_t position;
+    /** Number of cells in the block. */
+    std::size_t size;
+    /**
+     * Offset from the top of the block to the first cell that falls within
+     * the walked range.
+     */
+    std::size_t offset;
+    /** Type of the cells in the block. */
+    column_block_t type;
+    /**
+     * Opaque pointer to the data of the block.  It is nullptr when the
+     * model does not expose its cell storage.
+     */
+    const void* data;
+
+    column_block_shape_t();
+    column_block_shape_t(
+        std::size_t _position, std::size_t _size, std::size_t _offset,
+        column_block_t _type, const void* _data);
+    column_block_shape_t(const column_block_shape_t& other);
+    ~column_block_shape_t();
+
+    column_block_shape_t& operator= (const column_block_shape_t& other);
+};
+
+/**
+ * Callback function type to be called for each column block during a
+ * column block walk.  The first argument is the column index, and the
+ * second and third arguments are the first and last rows of the block that
+ * fall within the walked range.  The function should return true to
+ * continue the walk, or false to end it.
+ */
+using column_block_callback_t =
+    std::function<bool(col_t, row_t, row_t, const column_block_shape_t&)>;
+
+/**
+ * Callback function type to receive a contiguous array of numeric values.
+ * The first argument points to the first value in the array, and the
+ * second argument is the number of values in the array.
+ */
+using numeric_array_callback_t = std::function<void(const double*, size_t)>;
+
 /**
  * This structure stores a 2-dimensional size information.
  */
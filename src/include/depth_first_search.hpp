@@ -8,17 +8,28 @@
 #ifndef INCLUDED_IXION_DEPTH_FIRST_SEARCH_HPP
 #define INCLUDED_IXION_DEPTH_FIRST_SEARCH_HPP
 
-#include "ixion/exceptions.hpp"
-
 #include <vector>
-#include <set>
-#include <map>
-#include <exception>
-#include <iostream>
+#include <limits>
 #include <unordered_map>
+#include <utility>
+#include <cstdint>
 
 namespace ixion {
 
+/**
+ * Topological sort of values based on their precedent-dependent relations.
+ * Each value is mapped to a dense integer ID once, when it is first seen.
+ * From then on the graph is stored as adjacency arrays in compressed
+ * sparse row format, and the depth first search runs iteratively on those
+ * arrays with the visit state of each value kept in a flat array, so no
+ * hashing takes place during the search.
+ *
+ * The search starts from the values in the order they appear in the input
+ * sequence, and follows the dependencies of each value in the order of
+ * their positions in the input sequence.  The output is therefore one of
+ * the valid topological orders, which depends on the order of the input
+ * sequence.
+ */
 template<typename _ValueType, typename _ValueHashType>
 class depth_first_search
 {
@@ -29,28 +40,11 @@ public:
 private:
     typedef std::unordered_map<value_type, size_t, value_hash_type> value_index_map_type;
 
-    enum cell_color_type { white, gray, black };
-
-    class dfs_error : public general_error
-    {
-    public:
-        dfs_error(const std::string& msg) : general_error(msg) {}
-    };
+    enum cell_color_type : uint8_t { white, gray, black };
 
-    struct node_data
-    {
-        cell_color_type color;
-        value_type      node;
-        size_t          time_visited;
-        size_t          time_finished;
-
-        node_data() : color(white), time_visited(0), time_finished(0) {}
-    };
+    static constexpr size_t npos = std::numeric_limits<size_t>::max();
 
 public:
-    typedef std::set<value_type> precedent_cells_type;
-    typedef std::map<value_type, precedent_cells_type> precedent_map_type;
-
     class back_inserter
     {
         std::vector<value_type>& m_sorted;
@@ -65,38 +59,51 @@ public:
 
     /**
      * Stores all precedent-dependent relations which are to be used to
-     * perform topological sort.
+     * perform topological sort.  Each relation is stored as a pair of
+     * value IDs.
      */
     class relations
     {
         friend class depth_first_search;
 
     public:
-        void insert(value_type pre, value_type dep)
+        /**
+         * Get the ID of a value, assigning a new one if the value does not
+         * have one yet.  When inserting many relations that share the same
+         * value, getting its ID once and passing it to insert_by_id()
+         * avoids looking it up repeatedly.
+         */
+        size_t get_id(const value_type& v)
         {
-            typename precedent_map_type::iterator itr = m_map.find(pre);
-            if (itr == m_map.end())
-            {
-                // First dependent for this precedent.
-                std::pair<typename precedent_map_type::iterator, bool> r =
-                    m_map.insert(
-                        typename precedent_map_type::value_type(pre, precedent_cells_type()));
-
-                if (!r.second)
-                    throw dfs_error("failed to insert a new set instance");
+            auto r = m_ids.emplace(v, m_ids.size());
+            return r.first->second;
+        }
 
-                itr = r.first;
-            }
+        void insert(const value_type& pre, const value_type& dep)
+        {
+            insert_by_id(get_id(pre), get_id(dep));
+        }
 
-            itr->second.insert(dep);
+        void insert_by_id(size_t pre_id, size_t dep_id)
+        {
+            m_edges.emplace_back(pre_id, dep_id);
         }
 
     private:
-        const precedent_map_type& get() const { return m_map; }
-
-        precedent_map_type m_map;
+        value_index_map_type m_ids;
+        std::vector<std::pair<size_t, size_t>> m_edges;
     };
 
+    /**
+     * Constructor.
+     *
+     * @param begin iterator pointing to the first value to sort.
+     * @param end iterator pointing to the position past the last value to
+     *            sort.
+     * @param rels relations among the values.  Relations that involve
+     *             values outside the range of values to sort are ignored.
+     * @param handler handler receiving the sorted values one at a time.
+     */
     template<typename _Iter>
     depth_first_search(
         const _Iter& begin, const _Iter& end,
@@ -105,20 +112,21 @@ public:
     void run();
 
 private:
-    void init();
-
-    void visit(size_t cell_index);
-    size_t get_cell_index(const value_type& p) const;
-    const precedent_cells_type* get_precedent_cells(value_type cell);
+    void build_graph(const relations& rels);
 
 private:
-    const precedent_map_type& m_precedent_map;
     back_inserter m_handler;
-    size_t m_value_count;
-    value_index_map_type m_value_indices;
+    std::vector<value_type> m_values;
+
+    /** Position of the first dependency of each value in m_adjacency. */
+    std::vector<size_t> m_offsets;
 
-    size_t m_time_stamp;
-    std::vector<node_data> m_values;
+    /**
+     * Dependencies of all values, each stored as the position of the value
+     * in m_values.  The dependencies of each value are sorted in ascending
+     * order, without duplicates.
+     */
+    std::vector<size_t> m_adjacency;
 };
 
 template<typename _ValueType, typename _ValueHashType>
@@ -126,98 +134,127 @@ template<typename _Iter>
 depth_first_search<_ValueType,_ValueHashType>::depth_first_search(
     const _Iter& begin, const _Iter& end,
     const relations& rels, back_inserter handler) :
-    m_precedent_map(rels.get()),
     m_handler(std::move(handler)),
-    m_value_count(std::distance(begin, end)),
-    m_time_stamp(0),
-    m_values(m_value_count)
+    m_values(begin, end)
 {
-    // Construct value node to index mapping.
-    size_t i = 0;
-    for (_Iter it = begin; it != end; ++it, ++i)
-        m_value_indices.insert(
-            typename value_index_map_type::value_type(*it, i));
+    build_graph(rels);
 }
 
 template<typename _ValueType, typename _ValueHashType>
-void depth_first_search<_ValueType,_ValueHashType>::init()
+void depth_first_search<_ValueType,_ValueHashType>::build_graph(const relations& rels)
 {
-    std::vector<node_data> values(m_value_count);
+    size_t n = m_values.size();
 
-    // Now, construct index to cell node mapping.
-    for (const auto& vi : m_value_indices)
-        values[vi.second].node = vi.first;
+    // Map the relation IDs to the positions of the values.
+    std::vector<size_t> positions(rels.m_ids.size(), npos);
+    for (size_t i = 0; i < n; ++i)
+    {
+        auto it = rels.m_ids.find(m_values[i]);
+        if (it != rels.m_ids.end())
+            positions[it->second] = i;
+    }
 
-    m_values.swap(values);
-    m_time_stamp = 0;
-}
+    // Group the edges by their dependencies first, then by their
+    // precedents, so that the dependencies of each precedent end up sorted
+    // without any comparison sort.  Each pass is a counting sort.
+    std::vector<size_t> dep_offsets(n + 1, 0);
+    for (const auto& [pre_id, dep_id] : rels.m_edges)
+    {
+        size_t pre = positions[pre_id], dep = positions[dep_id];
+        if (pre != npos && dep != npos)
+            ++dep_offsets[dep + 1];
+    }
 
-template<typename _ValueType, typename _ValueHashType>
-void depth_first_search<_ValueType,_ValueHashType>::run()
-{
-    init();
+    for (size_t i = 0; i < n; ++i)
+        dep_offsets[i + 1] += dep_offsets[i];
 
-    try
+    std::vector<size_t> pres_by_dep(dep_offsets[n]);
     {
-        for (size_t i = 0; i < m_value_count; ++i)
-            if (m_values[i].color == white)
-                visit(i);
+        std::vector<size_t> pos(dep_offsets.begin(), dep_offsets.end() - 1);
+        for (const auto& [pre_id, dep_id] : rels.m_edges)
+        {
+            size_t pre = positions[pre_id], dep = positions[dep_id];
+            if (pre != npos && dep != npos)
+                pres_by_dep[pos[dep]++] = pre;
+        }
     }
-    catch(const dfs_error& e)
+
+    m_offsets.assign(n + 1, 0);
+    for (size_t pre : pres_by_dep)
+        ++m_offsets[pre + 1];
+
+    for (size_t i = 0; i < n; ++i)
+        m_offsets[i + 1] += m_offsets[i];
+
+    m_adjacency.resize(m_offsets[n]);
+    std::vector<size_t> pos(m_offsets.begin(), m_offsets.end() - 1);
+    for (size_t dep = 0; dep < n; ++dep)
     {
-        std::cout << "dfs error: " << e.what() << std::endl;
+        for (size_t i = dep_offsets[dep]; i < dep_offsets[dep + 1]; ++i)
+            m_adjacency[pos[pres_by_dep[i]]++] = dep;
     }
-}
-
-template<typename _ValueType, typename _ValueHashType>
-void depth_first_search<_ValueType,_ValueHashType>::visit(size_t cell_index)
-{
-    value_type p = m_values[cell_index].node;
-    m_values[cell_index].color = gray;
-    m_values[cell_index].time_visited = ++m_time_stamp;
 
-    do
+    // The same relation may have been inserted more than once.  Since the
+    // dependencies of each value are sorted, the duplicates are adjacent.
+    size_t dest = 0;
+    for (size_t v = 0; v < n; ++v)
     {
-        const precedent_cells_type* depends = get_precedent_cells(p);
-        if (!depends)
-            // No dependent cells.
-            break;
+        size_t row_begin = m_offsets[v], row_end = m_offsets[v + 1];
+        m_offsets[v] = dest;
 
-        for (const value_type& dcell : *depends)
+        for (size_t i = row_begin; i < row_end; ++i)
         {
-            size_t dcell_id = get_cell_index(dcell);
-            if (m_values[dcell_id].color == white)
-            {
-                visit(dcell_id);
-            }
+            if (dest > m_offsets[v] && m_adjacency[dest - 1] == m_adjacency[i])
+                continue;
+
+            m_adjacency[dest++] = m_adjacency[i];
         }
     }
-    while (false);
 
-    m_values[cell_index].color = black;
-    m_values[cell_index].time_finished = ++m_time_stamp;
-    m_handler(m_values[cell_index].node);
+    m_offsets[n] = dest;
+    m_adjacency.resize(dest);
 }
 
 template<typename _ValueType, typename _ValueHashType>
-size_t depth_first_search<_ValueType,_ValueHashType>::get_cell_index(const value_type& p) const
+void depth_first_search<_ValueType,_ValueHashType>::run()
 {
-    typename value_index_map_type::const_iterator itr = m_value_indices.find(p);
-    if (itr == m_value_indices.end())
-        throw dfs_error("cell ptr to index mapping failed.");
-    return itr->second;
-}
+    size_t n = m_values.size();
+    std::vector<cell_color_type> colors(n, white);
 
-template<typename _ValueType, typename _ValueHashType>
-const typename depth_first_search<_ValueType,_ValueHashType>::precedent_cells_type*
-depth_first_search<_ValueType,_ValueHashType>::get_precedent_cells(value_type cell)
-{
-    typename precedent_map_type::const_iterator itr = m_precedent_map.find(cell);
-    if (itr == m_precedent_map.end())
-        // This cell has no dependent cells.
-        return nullptr;
+    // Each entry stores a value being visited and the position of its next
+    // dependency to visit.
+    std::vector<std::pair<size_t, size_t>> stack;
+
+    for (size_t root = 0; root < n; ++root)
+    {
+        if (colors[root] != white)
+            continue;
+
+        colors[root] = gray;
+        stack.emplace_back(root, m_offsets[root]);
 
-    return &itr->second;
+        while (!stack.empty())
+        {
+            size_t v = stack.back().first;
+            size_t& next = stack.back().second;
+
+            if (next < m_offsets[v + 1])
+            {
+                size_t dep = m_adjacency[next++];
+                if (colors[dep] == white)
+                {
+                    colors[dep] = gray;
+                    stack.emplace_back(dep, m_offsets[dep]);
+                }
+                continue;
+            }
+
+            // All dependencies of this value have been visited.
+            colors[v] = black;
+            m_handler(m_values[v]);
+            stack.pop_back();
+        }
+    }
 }
 
 }
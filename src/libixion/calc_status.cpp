@@ -6,12 +6,127 @@
  */
 
 #include "calc_status.hpp"
+#include "object_pool.hpp"
+
+#include <cassert>
+#include <condition_variable>
+#include <cstdint>
 
 namespace ixion {
 
-calc_status::calc_status() : result(nullptr), circular_safe(false), refcount(0) {}
+namespace {
+
+/**
+ * Mutex and condition variable shared by all calc_status instances that map
+ * to the same slot.
+ */
+struct wait_slot
+{
+    std::mutex mtx;
+    std::condition_variable cond;
+};
+
+constexpr size_t wait_slot_count = 64;
+
+wait_slot& get_wait_slot(const calc_status* p)
+{
+    // The slots are never destroyed since they may be used during static
+    // destruction.
+    static wait_slot* slots = new wait_slot[wait_slot_count];
+
+    uintptr_t addr = reinterpret_cast<uintptr_t>(p);
+    return slots[((addr >> 6) ^ (addr >> 12)) % wait_slot_count];
+}
+
+}
+
+calc_status::calc_status() :
+    result_ready(false), circular_safe(false), has_prev_result(false), result_restored(false),
+    refcount(0) {}
 calc_status::calc_status(const rc_size_t& _group_size) :
-    result(nullptr), group_size(_group_size), circular_safe(false), refcount(0) {}
+    result_ready(false), group_size(_group_size), circular_safe(false), has_prev_result(false),
+    result_restored(false), refcount(0) {}
+
+void* calc_status::operator new(std::size_t size)
+{
+    assert(size == sizeof(calc_status));
+    (void)size;
+    return object_pool::get<calc_status>().allocate();
+}
+
+void calc_status::operator delete(void* p)
+{
+    object_pool::get<calc_status>().deallocate(p);
+}
+
+std::mutex& calc_status::get_mutex() const
+{
+    return get_wait_slot(this).mtx;
+}
+
+void calc_status::publish_result()
+{
+    result_ready.store(true, std::memory_order_release);
+
+    wait_slot& slot = get_wait_slot(this);
+
+    {
+        // Acquire the lock so that a waiting thread either sees the flag
+        // before it starts waiting, or is already waiting to be notified.
+        std::lock_guard<std::mutex> lock(slot.mtx);
+    }
+
+    // Other threads waiting on the same slot for different instances wake
+    // up as well, and go back to waiting after checking their own flags.
+    slot.cond.notify_all();
+}
+
+void calc_status::wait_for_result()
+{
+    if (is_result_ready())
+        return;
+
+    wait_slot& slot = get_wait_slot(this);
+    std::unique_lock<std::mutex> lock(slot.mtx);
+    slot.cond.wait(lock, [this] { return is_result_ready(); });
+}
+
+void calc_status::reset_result()
+{
+    if (result_ready.load(std::memory_order_relaxed))
+    {
+        // Swapping the two instances avoids copying the result, and the
+        // instance of the old previous result gets reused for the next one.
+        prev_result.swap(result);
+        has_prev_result = true;
+    }
+
+    result_ready.store(false, std::memory_order_relaxed);
+    result_restored = false;
+    result.reset();
+}
+
+bool calc_status::restore_prev_result()
+{
+    if (!has_prev_result)
+        return false;
+
+    result.swap(prev_result);
+    has_prev_result = false;
+    result_restored = true;
+    return true;
+}
+
+bool calc_status::is_result_changed() const
+{
+    if (result_restored)
+        return false;
+
+    if (!has_prev_result)
+        return true;
+
+    return !(result == prev_result);
+}
 
 void calc_status::add_ref()
 {
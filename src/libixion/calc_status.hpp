@@ -11,7 +11,7 @@
 #include "ixion/formula_result.hpp"
 
 #include <mutex>
-#include <condition_variable>
+#include <atomic>
 
 #include <boost/intrusive_ptr.hpp>
 
@@ -22,18 +22,89 @@ struct calc_status
     calc_status(const calc_status&) = delete;
     calc_status& operator=(const calc_status&) = delete;
 
-    std::mutex mtx;
-    std::condition_variable cond;
-    std::unique_ptr<formula_result> result;
+    /**
+     * Cached result.  It may be read without locking the mutex only after
+     * is_result_ready() returns true.  The same instance is reused across
+     * recalculations, so that storing a numeric or an error result does not
+     * allocate memory.
+     */
+    formula_result result;
+
+    /**
+     * Result from before the last reset, kept so that the new result can be
+     * compared with it, or restored in case the cell doesn't need to be
+     * interpreted again.
+     */
+    formula_result prev_result;
+
+    /**
+     * Flag that is set with release semantics after the result has been
+     * stored, so that a reader that sees it set also sees the result.
+     */
+    std::atomic<bool> result_ready;
 
     const rc_size_t group_size;
     bool circular_safe;
+    bool has_prev_result;
+    bool result_restored;
 
     size_t refcount;
 
     calc_status();
     calc_status(const rc_size_t& _group_size);
 
+    static void* operator new(std::size_t size);
+    static void operator delete(void* p);
+
+    /**
+     * Get the mutex that guards the result while it is being stored.  The
+     * mutex, together with the condition variable used to wait for the
+     * result, is shared with other calc_status instances, so that each
+     * instance need not carry its own.
+     */
+    std::mutex& get_mutex() const;
+
+    bool is_result_ready() const
+    {
+        return result_ready.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Mark the currently stored result as available, and wake up all threads
+     * waiting for it.  The result must be stored prior to calling this
+     * method.
+     */
+    void publish_result();
+
+    /**
+     * Block until the result becomes available.  It returns immediately
+     * without locking the mutex if the result is already available.
+     */
+    void wait_for_result();
+
+    /**
+     * Clear the stored result.  If the result is available, it is kept as
+     * the previous result.  This must not be called while other threads may
+     * be reading the result.
+     */
+    void reset_result();
+
+    /**
+     * Put the previous result back as the current result.  The result must
+     * be published afterward.
+     *
+     * @return true if the previous result has been restored, false if there
+     *         is no previous result.
+     */
+    bool restore_prev_result();
+
+    /**
+     * @return true if the current result differs from the previous result,
+     *         or there is no previous result, false otherwise.  A restored
+     *         result is never considered changed.
+     */
+    bool is_result_changed() const;
+
     void add_ref();
     void release_ref();
 };
@@ -18,6 +18,8 @@
 #include "ixion/formula.hpp"
 
 #include "formula_interpreter.hpp"
+#include "column_store_type.hpp"
+#include "object_pool.hpp"
 #include "debug.hpp"
 
 #include <cassert>
@@ -26,6 +28,7 @@
 #include <iostream>
 #include <algorithm>
 #include <functional>
+#include <utility>
 
 #include "calc_status.hpp"
 
@@ -44,7 +47,7 @@ std::string gen_trace_output(const formula_cell& fc, const iface::formula_model_
 {
     auto resolver = formula_name_resolver::get(formula_name_resolver_t::excel_a1, &cxt);
     std::ostringstream os;
-    os << "pos=" << pos.get_name() << "; formula='" << print_formula_tokens(cxt, pos, *resolver, fc.get_tokens()->get()) << "'";
+    os << "pos=" << pos.get_name() << "; formula='" << print_formula_tokens(cxt, pos, *resolver, std::as_const(*fc.get_tokens()).get()) << "'";
     return os.str();
 }
 
@@ -68,20 +71,31 @@ struct formula_cell::impl
         m_tokens(tokens),
         m_group_pos(row, col, false, false) {}
 
+    static void* operator new(std::size_t size)
+    {
+        assert(size == sizeof(impl));
+        (void)size;
+        return object_pool::get<impl>().allocate();
+    }
+
+    static void operator delete(void* p)
+    {
+        object_pool::get<impl>().deallocate(p);
+    }
+
     /**
-     * Block until the result becomes available.
+     * Block until the result becomes available if the policy says so.  No
+     * lock is taken when the result is already available.
      *
-     * @param lock mutex lock associated with the result cache data.
+     * @param policy action to take in case the result is not yet available.
      */
-    void wait_for_interpreted_result(std::unique_lock<std::mutex>& lock) const
+    void wait_for_interpreted_result(formula_result_wait_policy_t policy) const
     {
-        IXION_TRACE("Wait for the interpreted result");
+        if (policy != formula_result_wait_policy_t::block_until_done)
+            return;
 
-        while (!m_calc_status->result)
-        {
-            IXION_TRACE("Waiting...");
-            m_calc_status->cond.wait(lock);
-        }
+        IXION_TRACE("Wait for the interpreted result");
+        m_calc_status->wait_for_result();
     }
 
     void reset_flag()
@@ -100,16 +114,20 @@ struct formula_cell::impl
         return m_calc_status->circular_safe;
     }
 
+    void set_circular_error()
+    {
+        IXION_DEBUG("Circular dependency detected !!");
+        assert(!m_calc_status->is_result_ready());
+        m_calc_status->result.set_error(formula_error_t::ref_result_not_available);
+        m_calc_status->publish_result();
+    }
+
     bool check_ref_for_circular_safety(const formula_cell& ref, const abs_address_t& pos)
     {
         if (!ref.mp_impl->is_circular_safe())
         {
             // Circular dependency detected !!
-            IXION_DEBUG("Circular dependency detected !!");
-            assert(!m_calc_status->result);
-            m_calc_status->result =
-                std::make_unique<formula_result>(formula_error_t::ref_result_not_available);
-
+            set_circular_error();
             return false;
         }
         return true;
@@ -117,18 +135,18 @@ struct formula_cell::impl
 
     void check_calc_status_or_throw() const
     {
-        if (!m_calc_status->result)
+        if (!m_calc_status->is_result_ready())
         {
             // Result not cached yet.  Reference error.
             IXION_DEBUG("Result not cached yet. This is a reference error.");
             throw formula_error(formula_error_t::ref_result_not_available);
         }
 
-        if (m_calc_status->result->get_type() == formula_result::result_type::error)
+        if (m_calc_status->result.get_type() == formula_result::result_type::error)
         {
             // Error condition.
             IXION_DEBUG("Error in result.");
-            throw formula_error(m_calc_status->result->get_error());
+            throw formula_error(m_calc_status->result.get_error());
         }
     }
 
@@ -136,14 +154,14 @@ struct formula_cell::impl
     {
         check_calc_status_or_throw();
 
-        switch (m_calc_status->result->get_type())
+        switch (m_calc_status->result.get_type())
         {
             case formula_result::result_type::value:
-                return m_calc_status->result->get_value();
+                return m_calc_status->result.get_value();
             case formula_result::result_type::matrix:
             {
                 IXION_TRACE("Fetching a matrix result.");
-                const matrix& m = m_calc_status->result->get_matrix();
+                const matrix& m = m_calc_status->result.get_matrix();
                 row_t row_size = m.row_size();
                 col_t col_size = m.col_size();
 
@@ -170,7 +188,7 @@ struct formula_cell::impl
             {
                 std::ostringstream os;
                 os << "numeric result was requested, but the actual result is of "
-                    << m_calc_status->result->get_type() << " type.";
+                    << m_calc_status->result.get_type() << " type.";
                 throw formula_error(
                     formula_error_t::invalid_value_type,
                     os.str()
@@ -183,13 +201,13 @@ struct formula_cell::impl
     {
         check_calc_status_or_throw();
 
-        switch (m_calc_status->result->get_type())
+        switch (m_calc_status->result.get_type())
         {
             case formula_result::result_type::string:
-                return m_calc_status->result->get_string();
+                return m_calc_status->result.get_string();
             case formula_result::result_type::matrix:
             {
-                const matrix& m = m_calc_status->result->get_matrix();
+                const matrix& m = m_calc_status->result.get_matrix();
                 row_t row_size = m.row_size();
                 col_t col_size = m.col_size();
 
@@ -214,7 +232,7 @@ struct formula_cell::impl
             {
                 std::ostringstream os;
                 os << "string result was requested, but the actual result is of "
-                    << m_calc_status->result->get_type() << " type.";
+                    << m_calc_status->result.get_type() << " type.";
                 throw formula_error(
                     formula_error_t::invalid_value_type,
                     os.str()
@@ -283,43 +301,86 @@ struct formula_cell::impl
         }
     }
 
+    cell_value_t get_single_value_type(const formula_result& src) const
+    {
+        switch (src.get_type())
+        {
+            case formula_result::result_type::value:
+                return cell_value_t::numeric;
+            case formula_result::result_type::string:
+                return cell_value_t::string;
+            case formula_result::result_type::error:
+                return cell_value_t::error;
+            case formula_result::result_type::matrix:
+                break;
+        }
+
+        const matrix& m = src.get_matrix();
+        row_t row_size = m.row_size();
+        col_t col_size = m.col_size();
+
+        if (m_group_pos.row >= row_size || m_group_pos.column >= col_size)
+            return cell_value_t::error;
+
+        switch (m.get(m_group_pos.row, m_group_pos.column).type)
+        {
+            case matrix::element_type::numeric:
+            case matrix::element_type::boolean:
+            case matrix::element_type::empty:
+                return cell_value_t::numeric;
+            case matrix::element_type::string:
+                return cell_value_t::string;
+            case matrix::element_type::error:
+                return cell_value_t::error;
+        }
+
+        return cell_value_t::unknown;
+    }
+
     void set_single_formula_result(formula_result result)
     {
         if (is_grouped())
         {
-            std::unique_lock<std::mutex> lock(m_calc_status->mtx);
-
-            if (!m_calc_status->result)
             {
-                m_calc_status->result =
-                    std::make_unique<formula_result>(
+                std::unique_lock<std::mutex> lock(m_calc_status->get_mutex());
+
+                if (m_calc_status->result.get_type() != formula_result::result_type::matrix)
+                {
+                    // This is the first cell in the group to receive its result.
+                    m_calc_status->result.set_matrix(
                         matrix(m_calc_status->group_size.row, m_calc_status->group_size.column));
-            }
+                }
 
-            matrix& m = m_calc_status->result->get_matrix();
-            assert(m_group_pos.row < row_t(m.row_size()));
-            assert(m_group_pos.column < col_t(m.col_size()));
+                matrix& m = m_calc_status->result.get_matrix();
+                assert(m_group_pos.row < row_t(m.row_size()));
+                assert(m_group_pos.column < col_t(m.col_size()));
 
-            switch (result.get_type())
-            {
-                case formula_result::result_type::value:
-                    m.set(m_group_pos.row, m_group_pos.column, result.get_value());
-                    break;
-                case formula_result::result_type::string:
-                    m.set(m_group_pos.row, m_group_pos.column, result.get_string());
-                    break;
-                case formula_result::result_type::error:
-                    m.set(m_group_pos.row, m_group_pos.column, result.get_error());
-                    break;
-                case formula_result::result_type::matrix:
-                    throw std::logic_error("setting a cached result of matrix value directly is not yet supported.");
+                switch (result.get_type())
+                {
+                    case formula_result::result_type::value:
+                        m.set(m_group_pos.row, m_group_pos.column, result.get_value());
+                        break;
+                    case formula_result::result_type::string:
+                        m.set(m_group_pos.row, m_group_pos.column, result.get_string());
+                        break;
+                    case formula_result::result_type::error:
+                        m.set(m_group_pos.row, m_group_pos.column, result.get_error());
+                        break;
+                    case formula_result::result_type::matrix:
+                        throw std::logic_error("setting a cached result of matrix value directly is not yet supported.");
+                }
             }
 
+            m_calc_status->publish_result();
             return;
         }
 
-        std::unique_lock<std::mutex> lock(m_calc_status->mtx);
-        m_calc_status->result = std::make_unique<formula_result>(std::move(result));
+        {
+            std::unique_lock<std::mutex> lock(m_calc_status->get_mutex());
+            m_calc_status->result = std::move(result);
+        }
+
+        m_calc_status->publish_result();
     }
 };
 
@@ -338,6 +399,18 @@ formula_cell::~formula_cell()
 {
 }
 
+void* formula_cell::operator new(std::size_t size)
+{
+    assert(size == sizeof(formula_cell));
+    (void)size;
+    return object_pool::get<formula_cell>().allocate();
+}
+
+void formula_cell::operator delete(void* p)
+{
+    object_pool::get<formula_cell>().deallocate(p);
+}
+
 const formula_tokens_store_ptr_t& formula_cell::get_tokens() const
 {
     return mp_impl->m_tokens;
@@ -350,17 +423,13 @@ void formula_cell::set_tokens(const formula_tokens_store_ptr_t& tokens)
 
 double formula_cell::get_value(formula_result_wait_policy_t policy) const
 {
-    std::unique_lock<std::mutex> lock(mp_impl->m_calc_status->mtx);
-    if (policy == formula_result_wait_policy_t::block_until_done)
-        mp_impl->wait_for_interpreted_result(lock);
+    mp_impl->wait_for_interpreted_result(policy);
     return mp_impl->fetch_value_from_result();
 }
 
 std::string_view formula_cell::get_string(formula_result_wait_policy_t policy) const
 {
-    std::unique_lock<std::mutex> lock(mp_impl->m_calc_status->mtx);
-    if (policy == formula_result_wait_policy_t::block_until_done)
-        mp_impl->wait_for_interpreted_result(lock);
+    mp_impl->wait_for_interpreted_result(policy);
     return mp_impl->fetch_string_from_result();
 }
 
@@ -373,49 +442,61 @@ void formula_cell::interpret(iface::formula_model_access& context, const abs_add
 
     calc_status& status = *mp_impl->m_calc_status;
 
+    if (status.is_result_ready())
     {
-        std::lock_guard<std::mutex> lock(status.mtx);
-
-        if (mp_impl->m_calc_status->result)
+        // When the result is already cached before the cell is interpreted,
+        // it can mean the cell has circular dependency.
+        if (status.result.get_type() == formula_result::result_type::error)
         {
-            // When the result is already cached before the cell is interpreted,
-            // it can mean the cell has circular dependency.
-            if (status.result->get_type() == formula_result::result_type::error)
+            auto handler = context.create_session_handler();
+            if (handler)
             {
-                auto handler = context.create_session_handler();
-                if (handler)
-                {
-                    handler->begin_cell_interpret(pos);
-                    std::string_view msg = get_formula_error_name(status.result->get_error());
-                    handler->set_formula_error(msg);
-                    handler->end_cell_interpret();
-                }
+                handler->begin_cell_interpret(pos);
+                std::string_view msg = get_formula_error_name(status.result.get_error());
+                handler->set_formula_error(msg);
+                handler->end_cell_interpret();
             }
-            return;
         }
 
-        formula_interpreter fin(this, context);
-        fin.set_origin(pos);
-        status.result = std::make_unique<formula_result>();
-        if (fin.interpret())
-        {
-            // Successful interpretation.
-            *status.result = fin.transfer_result();
-        }
-        else
-        {
-            // Interpretation ended with an error condition.
-            status.result->set_error(fin.get_error());
-        }
+        context.publish_formula_result(pos, *this);
+        return;
     }
 
-    status.cond.notify_all();
+    // Nobody reads the result until it gets published, so there is no need
+    // to hold the lock during interpretation.
+    formula_interpreter_lease lease(this, context);
+    formula_interpreter& fin = lease.get();
+    fin.set_origin(pos);
+    // The program compiled from the tokens is shared by all cells sharing
+    // the same token store.
+    formula_tokens_store& ts = *mp_impl->m_tokens;
+    fin.set_program(detail::formula_program_cache::get(ts));
+    if (fin.interpret())
+    {
+        // Successful interpretation.
+        fin.transfer_result(status.result);
+    }
+    else
+    {
+        // Interpretation ended with an error condition.
+        status.result.set_error(fin.get_error());
+    }
+
+    if (!detail::formula_program_cache::get(ts))
+    {
+        std::unique_ptr<formula_program> program = fin.release_program();
+        if (program)
+            detail::formula_program_cache::set(ts, std::move(program));
+    }
+
+    status.publish_result();
+    context.publish_formula_result(pos, *this);
 }
 
-void formula_cell::check_circular(const iface::formula_model_access& cxt, const abs_address_t& pos)
+bool formula_cell::check_circular(const iface::formula_model_access& cxt, const abs_address_t& pos)
 {
     // TODO: Check to make sure this is being run on the main thread only.
-    const formula_tokens_t& tokens = mp_impl->m_tokens->get();
+    const formula_tokens_t& tokens = std::as_const(*mp_impl->m_tokens).get();
     for (const std::unique_ptr<formula_token>& t : tokens)
     {
         switch (t->get_opcode())
@@ -429,43 +510,63 @@ void formula_cell::check_circular(const iface::formula_model_access& cxt, const
                     continue;
 
                 if (!mp_impl->check_ref_for_circular_safety(*ref, addr))
-                    return;
+                    return false;
 
                 break;
             }
             case fop_range_ref:
             {
                 abs_range_t range = t->get_range_ref().to_abs(pos);
-                for (sheet_t sheet = range.first.sheet; sheet <= range.last.sheet; ++sheet)
+                sheet_t sheet = range.first.sheet;
+                bool safe = true;
+
+                // Walk the range one column block at a time, and inspect only
+                // the cells in the formula blocks.  All the other blocks get
+                // skipped in one step.
+                column_block_callback_t cb = [this, &cxt, &sheet, &safe](
+                    col_t col, row_t row1, row_t row2, const column_block_shape_t& node)
                 {
-                    rc_size_t sheet_size = cxt.get_sheet_size();
-                    col_t col_first = range.first.column, col_last = range.last.column;
-                    if (range.all_columns())
-                    {
-                        col_first = 0;
-                        col_last = sheet_size.column - 1;
-                    }
+                    if (node.type != column_block_t::formula)
+                        return true;
 
-                    for (col_t col = col_first; col <= col_last; ++col)
+                    if (!node.data)
                     {
-                        row_t row_first = range.first.row, row_last = range.last.row;
-                        if (range.all_rows())
+                        // The model does not expose its storage.
+                        for (row_t row = row1; row <= row2; ++row)
                         {
-                            assert(row_last == row_unset);
-                            row_first = 0;
-                            row_last = sheet_size.row - 1;
+                            abs_address_t addr(sheet, row, col);
+                            const formula_cell* ref = cxt.get_formula_cell(addr);
+                            if (ref && !mp_impl->check_ref_for_circular_safety(*ref, addr))
+                            {
+                                safe = false;
+                                return false;
+                            }
                         }
 
-                        for (row_t row = row_first; row <= row_last; ++row)
-                        {
-                            abs_address_t addr(sheet, row, col);
-                            if (cxt.get_celltype(addr) != celltype_t::formula)
-                                continue;
+                        return true;
+                    }
+
+                    const auto& blk = *static_cast<const mdds::mtv::base_element_block*>(node.data);
+                    formula_cell* const* pp = &formula_element_block::at(blk, node.offset);
 
-                            if (!mp_impl->check_ref_for_circular_safety(*cxt.get_formula_cell(addr), addr))
-                                return;
+                    for (row_t row = row1; row <= row2; ++row, ++pp)
+                    {
+                        abs_address_t addr(sheet, row, col);
+                        if (!mp_impl->check_ref_for_circular_safety(**pp, addr))
+                        {
+                            safe = false;
+                            return false;
                         }
                     }
+
+                    return true;
+                };
+
+                for (; sheet <= range.last.sheet; ++sheet)
+                {
+                    cxt.walk(sheet, range, cb);
+                    if (!safe)
+                        return false;
                 }
 
                 break;
@@ -478,15 +579,53 @@ void formula_cell::check_circular(const iface::formula_model_access& cxt, const
 
     // No circular dependencies.  Good.
     mp_impl->m_calc_status->circular_safe = true;
+    return true;
+}
+
+void formula_cell::set_circular_safe(bool safe)
+{
+    if (safe)
+        mp_impl->m_calc_status->circular_safe = true;
+    else
+        mp_impl->set_circular_error();
 }
 
 void formula_cell::reset()
 {
-    std::lock_guard<std::mutex> lock(mp_impl->m_calc_status->mtx);
-    mp_impl->m_calc_status->result.reset();
+    std::lock_guard<std::mutex> lock(mp_impl->m_calc_status->get_mutex());
+    mp_impl->m_calc_status->reset_result();
     mp_impl->reset_flag();
 }
 
+void formula_cell::reset(iface::formula_model_access& cxt, const abs_address_t& pos)
+{
+    reset();
+    cxt.reset_formula_result(pos);
+}
+
+bool formula_cell::restore_previous_result()
+{
+    calc_status& status = *mp_impl->m_calc_status;
+
+    {
+        std::lock_guard<std::mutex> lock(status.get_mutex());
+        if (!status.restore_prev_result())
+            return false;
+    }
+
+    status.publish_result();
+    return true;
+}
+
+bool formula_cell::has_result_changed() const
+{
+    const calc_status& status = *mp_impl->m_calc_status;
+    if (!status.is_result_ready())
+        return true;
+
+    return status.is_result_changed();
+}
+
 std::vector<const formula_token*> formula_cell::get_ref_tokens(
     const iface::formula_model_access& cxt, const abs_address_t& pos) const
 {
@@ -518,7 +657,7 @@ std::vector<const formula_token*> formula_cell::get_ref_tokens(
         }
     };
 
-    const formula_tokens_t& this_tokens = mp_impl->m_tokens->get();
+    const formula_tokens_t& this_tokens = std::as_const(*mp_impl->m_tokens).get();
 
     std::for_each(this_tokens.begin(), this_tokens.end(), get_refs);
 
@@ -527,18 +666,15 @@ std::vector<const formula_token*> formula_cell::get_ref_tokens(
 
 const formula_result& formula_cell::get_raw_result_cache(formula_result_wait_policy_t policy) const
 {
-    std::unique_lock<std::mutex> lock(mp_impl->m_calc_status->mtx);
-
-    if (policy == formula_result_wait_policy_t::block_until_done)
-        mp_impl->wait_for_interpreted_result(lock);
+    mp_impl->wait_for_interpreted_result(policy);
 
-    if (!mp_impl->m_calc_status->result)
+    if (!mp_impl->m_calc_status->is_result_ready())
     {
         IXION_DEBUG("Result not yet available.");
         throw formula_error(formula_error_t::ref_result_not_available);
     }
 
-    return *mp_impl->m_calc_status->result;
+    return mp_impl->m_calc_status->result;
 }
 
 formula_result formula_cell::get_result_cache(formula_result_wait_policy_t policy) const
@@ -547,9 +683,22 @@ formula_result formula_cell::get_result_cache(formula_result_wait_policy_t polic
     return mp_impl->get_single_formula_result(src);
 }
 
+cell_value_t formula_cell::get_value_type(formula_result_wait_policy_t policy) const
+{
+    const formula_result& src = get_raw_result_cache(policy);
+    return mp_impl->get_single_value_type(src);
+}
+
 void formula_cell::set_result_cache(formula_result result)
 {
-    mp_impl->set_single_formula_result(result);
+    mp_impl->set_single_formula_result(std::move(result));
+}
+
+void formula_cell::set_result_cache(
+    iface::formula_model_access& cxt, const abs_address_t& pos, formula_result result)
+{
+    set_result_cache(std::move(result));
+    cxt.publish_formula_result(pos, *this);
 }
 
 formula_group_t formula_cell::get_group_properties() const
@@ -7,14 +7,15 @@
 
 #include "cell_queue_manager.hpp"
 #include "queue_entry.hpp"
+#include "thread_pool.hpp"
+#include "dependency_graph.hpp"
+#include "model_context_impl.hpp"
 #include "ixion/cell.hpp"
 
 #include "ixion/interface/formula_model_access.hpp"
 
 #include <cassert>
-#include <queue>
-#include <future>
-#include <algorithm>
+#include <atomic>
 
 #if !IXION_THREADS
 #error "This file is not to be compiled when the threads are disabled."
@@ -22,121 +23,122 @@
 
 namespace ixion {
 
-namespace {
-
-class scoped_guard
-{
-    std::thread m_thread;
-public:
-    scoped_guard(std::thread thread) : m_thread(std::move(thread)) {}
-    scoped_guard(scoped_guard&& other) : m_thread(std::move(other.m_thread)) {}
-
-    scoped_guard(const scoped_guard&) = delete;
-    scoped_guard& operator= (const scoped_guard&) = delete;
-
-    ~scoped_guard()
-    {
-        m_thread.join();
-    }
-};
-
-class interpreter_queue
+struct formula_cell_queue::impl
 {
-    using future_type = std::future<void>;
-
     iface::formula_model_access& m_context;
-
-    std::queue<future_type> m_futures;
-    std::mutex m_mtx;
-    std::condition_variable m_cond;
-
-    size_t m_max_queue;
-
-    void interpret(formula_cell* p, const abs_address_t& pos)
-    {
-        p->interpret(m_context, pos);
-    }
-
-public:
-    interpreter_queue(iface::formula_model_access& cxt, size_t max_queue) :
-        m_context(cxt), m_max_queue(max_queue) {}
+    std::vector<queue_entry> m_cells;
+    const dependency_graph& m_graph;
+    size_t m_thread_count;
 
     /**
-     * Push one formula cell to the interpreter queue for future
-     * intepretation.
-     *
-     * @param p pointer to formula cell instance.
-     * @param pos position of the formual cell.
+     * Number of precedents yet to be calculated for each formula cell.
      */
-    void push(formula_cell* p, const abs_address_t& pos)
-    {
-        std::unique_lock<std::mutex> lock(m_mtx);
-
-        while (m_futures.size() >= m_max_queue)
-            m_cond.wait(lock);
-
-        future_type f = std::async(
-            std::launch::async, &interpreter_queue::interpret, this, p, pos);
-        m_futures.push(std::move(f));
-        lock.unlock();
-
-        m_cond.notify_one();
-    }
+    std::unique_ptr<std::atomic<size_t>[]> m_pending_precedents;
 
     /**
-     * Wait for one formula cell to finish its interpretation.
+     * Flag for each formula cell indicating whether it must be interpreted,
+     * or nullptr if all cells must be interpreted.  A flag may be set by
+     * any of the cell's precedents, but is read only after all of them have
+     * been calculated.
      */
-    void wait_one()
-    {
-        std::unique_lock<std::mutex> lock(m_mtx);
+    std::unique_ptr<std::atomic<bool>[]> m_dirty;
 
-        while (m_futures.empty())
-            m_cond.wait(lock);
+    thread_pool* mp_pool;
 
-        future_type ret = std::move(m_futures.front());
-        m_futures.pop();
-        lock.unlock();
-
-        ret.get();  // This may throw if an exception was thrown on the thread.
-
-        m_cond.notify_one();
+    impl(iface::formula_model_access& cxt, std::vector<queue_entry>&& cells,
+            const dependency_graph& graph, size_t thread_count, const std::vector<bool>* dirty) :
+        m_context(cxt),
+        m_cells(std::move(cells)),
+        m_graph(graph),
+        m_thread_count(thread_count),
+        mp_pool(nullptr)
+    {
+        assert(m_cells.size() == m_graph.size());
+
+        if (dirty)
+        {
+            assert(dirty->size() == m_cells.size());
+            m_dirty = std::make_unique<std::atomic<bool>[]>(m_cells.size());
+            for (size_t i = 0; i < m_cells.size(); ++i)
+                m_dirty[i].store((*dirty)[i], std::memory_order_relaxed);
+        }
     }
-};
 
-}
-
-struct formula_cell_queue::impl
-{
-    iface::formula_model_access& m_context;
-    std::vector<queue_entry> m_cells;
-    size_t m_thread_count;
-
-    impl(iface::formula_model_access& cxt, std::vector<queue_entry>&& cells, size_t thread_count) :
-        m_context(cxt),
-        m_cells(cells),
-        m_thread_count(thread_count) {}
+    void push(size_t node)
+    {
+        mp_pool->push([this, node]() { interpret(node); });
+    }
 
-    void thread_launch(interpreter_queue* queue)
+    void interpret(size_t node)
     {
-        for (queue_entry& e : m_cells)
-            queue->push(e.p, e.pos);
+        queue_entry& e = m_cells[node];
+        bool changed = true;
+
+        if (m_dirty && !m_dirty[node].load(std::memory_order_relaxed) && e.p->restore_previous_result())
+        {
+            m_context.publish_formula_result(e.pos, *e.p);
+            changed = false;
+        }
+        else
+        {
+            e.p->interpret(m_context, e.pos);
+            if (m_dirty)
+                changed = e.p->has_result_changed();
+        }
+
+        // Dispatch the dependents whose precedents are now all calculated.
+        // Relationships to preceding nodes are part of circular
+        // dependencies, and are not counted.  The decrement of the counter
+        // makes the dirty flag visible to the thread that dispatches the
+        // dependent.
+        for (size_t dep : m_graph.get_dependents(node))
+        {
+            if (dep <= node)
+                continue;
+
+            if (changed && m_dirty)
+                m_dirty[dep].store(true, std::memory_order_relaxed);
+
+            if (--m_pending_precedents[dep] == 0)
+                push(dep);
+        }
     }
 
     void run()
     {
-        interpreter_queue queue(m_context, m_thread_count);
-
-        std::thread t(&formula_cell_queue::impl::thread_launch, this, &queue);
-        scoped_guard guard(std::move(t));
-
-        for (size_t i = 0, n = m_cells.size(); i < n; ++i)
-            queue.wait_one();
+        // Use the pool owned by the model if available, else create a
+        // temporary one just for this run.
+        std::unique_ptr<thread_pool> local_pool;
+        mp_pool = detail::model_thread_pool::get(m_context, m_thread_count);
+        if (!mp_pool)
+        {
+            local_pool = std::make_unique<thread_pool>(m_thread_count);
+            mp_pool = local_pool.get();
+        }
+
+        const size_t n = m_cells.size();
+        m_pending_precedents = std::make_unique<std::atomic<size_t>[]>(n);
+        for (size_t i = 0; i < n; ++i)
+            m_pending_precedents[i] = m_graph.get_precedent_count(i);
+
+        // Dispatch all cells that have no precedents to wait for, in
+        // topological order.  The rest get dispatched as their precedents
+        // finish.
+        for (size_t i = 0; i < n; ++i)
+        {
+            if (!m_pending_precedents[i])
+                push(i);
+        }
+
+        mp_pool->wait(); // This may throw if an exception was thrown on the thread.
+        mp_pool = nullptr;
     }
 };
 
 formula_cell_queue::formula_cell_queue(
-    iface::formula_model_access& cxt, std::vector<queue_entry>&& cells, size_t thread_count) :
-    mp_impl(std::make_unique<impl>(cxt, std::move(cells), thread_count)) {}
+    iface::formula_model_access& cxt, std::vector<queue_entry>&& cells,
+    const dependency_graph& graph, size_t thread_count, const std::vector<bool>* dirty) :
+    mp_impl(std::make_unique<impl>(cxt, std::move(cells), graph, thread_count, dirty)) {}
 
 formula_cell_queue::~formula_cell_queue() {}
 
@@ -16,6 +16,7 @@
 namespace ixion {
 
 class formula_cell;
+class dependency_graph;
 struct queue_entry;
 
 namespace iface {
@@ -25,7 +26,10 @@ class formula_model_access;
 }
 
 /**
- * Class that manages multi-threaded calculation of formula cells.
+ * Class that manages multi-threaded calculation of formula cells.  A
+ * formula cell gets dispatched to the worker threads only after all of its
+ * precedents have been calculated, so that the workers never have to wait
+ * for the results of other formula cells.
  */
 class formula_cell_queue
 {
@@ -35,10 +39,26 @@ class formula_cell_queue
 public:
     formula_cell_queue() = delete;
 
+    /**
+     * Constructor.
+     *
+     * @param cxt model context.
+     * @param cells formula cells to calculate, in topological order.
+     * @param graph dependency graph whose nodes correspond with the formula
+     *              cells in the same order.
+     * @param thread_count number of calculation threads to use.
+     * @param dirty (optional) flags indicating which formula cells must be
+     *              interpreted, in the same order as the cells.  The other
+     *              cells are interpreted only when a precedent's result
+     *              changes, else their previous results get restored.  When
+     *              not given, all cells are interpreted.
+     */
     formula_cell_queue(
         iface::formula_model_access& cxt,
         std::vector<queue_entry>&& cells,
-        size_t thread_count);
+        const dependency_graph& graph,
+        size_t thread_count,
+        const std::vector<bool>* dirty = nullptr);
 
     ~formula_cell_queue();
 
@@ -12,6 +12,7 @@
 #include "ixion/formula.hpp"
 
 #include <sstream>
+#include <utility>
 
 namespace ixion { namespace detail {
 
@@ -19,7 +20,7 @@ std::string print_formula_expression(const iface::formula_model_access& cxt, con
 {
     auto resolver = formula_name_resolver::get(formula_name_resolver_t::excel_a1, &cxt);
     assert(resolver);
-    const formula_tokens_t& tokens = cell.get_tokens()->get();
+    const formula_tokens_t& tokens = std::as_const(*cell.get_tokens()).get();
     return print_formula_tokens(cxt, pos, *resolver, tokens);
 }
 
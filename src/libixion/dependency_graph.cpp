@@ -0,0 +1,184 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "dependency_graph.hpp"
+
+#include "ixion/dirty_cell_tracker.hpp"
+#include "ixion/interface/formula_model_access.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <unordered_map>
+
+namespace ixion {
+
+dependency_graph::dependency_graph(
+    const iface::formula_model_access& cxt, const std::vector<abs_range_t>& cells)
+{
+    const size_t n = cells.size();
+
+    std::unordered_map<abs_range_t, node_type, abs_range_t::hash> node_map;
+    node_map.reserve(n);
+    for (node_type i = 0; i < n; ++i)
+        node_map.emplace(cells[i], i);
+
+    const dirty_cell_tracker& tracker = cxt.get_cell_tracker();
+
+    m_offsets.reserve(n + 1);
+    m_offsets.push_back(0);
+    m_precedent_counts.assign(n, 0);
+
+    for (node_type i = 0; i < n; ++i)
+    {
+        for (const abs_range_t& r : tracker.query_direct_dependents(cells[i]))
+        {
+            auto it = node_map.find(r);
+            if (it == node_map.end())
+                // Not part of this calculation run.
+                continue;
+
+            node_type dep = it->second;
+            m_dependents.push_back(dep);
+
+            if (i < dep)
+                ++m_precedent_counts[dep];
+        }
+
+        auto it_begin = m_dependents.begin() + m_offsets.back();
+        std::sort(it_begin, m_dependents.end());
+
+        m_offsets.push_back(m_dependents.size());
+    }
+}
+
+size_t dependency_graph::size() const
+{
+    return m_precedent_counts.size();
+}
+
+dependency_graph::node_range dependency_graph::get_dependents(node_type node) const
+{
+    const node_type* p = m_dependents.data();
+    return node_range(p + m_offsets[node], p + m_offsets[node+1]);
+}
+
+size_t dependency_graph::get_precedent_count(node_type node) const
+{
+    return m_precedent_counts[node];
+}
+
+std::vector<bool> dependency_graph::find_circular_nodes() const
+{
+    const size_t n = size();
+    const size_t unvisited = std::numeric_limits<size_t>::max();
+
+    std::vector<bool> circular(n, false);
+
+    std::vector<size_t> index(n, unvisited);
+    std::vector<size_t> lowlink(n, 0);
+    std::vector<bool> on_stack(n, false);
+    std::vector<node_type> scc_stack;
+    size_t next_index = 0;
+
+    // Each call stack entry stores the node being visited and the position
+    // of its next dependent to visit.
+    std::vector<std::pair<node_type, const node_type*>> call_stack;
+
+    auto visit = [&](node_type v)
+    {
+        index[v] = lowlink[v] = next_index++;
+        scc_stack.push_back(v);
+        on_stack[v] = true;
+        call_stack.emplace_back(v, get_dependents(v).begin());
+    };
+
+    for (node_type root = 0; root < n; ++root)
+    {
+        if (index[root] != unvisited)
+            continue;
+
+        visit(root);
+
+        while (!call_stack.empty())
+        {
+            node_type v = call_stack.back().first;
+            const node_type* it = call_stack.back().second;
+
+            if (it != get_dependents(v).end())
+            {
+                node_type w = *it;
+                ++call_stack.back().second;
+
+                if (w == v)
+                    // Self-referencing node.
+                    circular[v] = true;
+                else if (index[w] == unvisited)
+                    visit(w);
+                else if (on_stack[w])
+                    lowlink[v] = std::min(lowlink[v], index[w]);
+
+                continue;
+            }
+
+            // All dependents of this node have been visited.
+            call_stack.pop_back();
+
+            if (!call_stack.empty())
+            {
+                node_type u = call_stack.back().first;
+                lowlink[u] = std::min(lowlink[u], lowlink[v]);
+            }
+
+            if (lowlink[v] != index[v])
+                continue;
+
+            // This node is the root of a strongly connected component.  A
+            // component with more than one node is a circular dependency.
+            bool cycle = scc_stack.back() != v;
+            while (true)
+            {
+                node_type w = scc_stack.back();
+                scc_stack.pop_back();
+                on_stack[w] = false;
+                if (cycle)
+                    circular[w] = true;
+
+                if (w == v)
+                    break;
+            }
+        }
+    }
+
+    // Propagate the flags to all nodes downstream.
+    std::vector<node_type> queue;
+    for (node_type i = 0; i < n; ++i)
+    {
+        if (circular[i])
+            queue.push_back(i);
+    }
+
+    while (!queue.empty())
+    {
+        node_type v = queue.back();
+        queue.pop_back();
+
+        for (node_type w : get_dependents(v))
+        {
+            if (circular[w])
+                continue;
+
+            circular[w] = true;
+            queue.push_back(w);
+        }
+    }
+
+    return circular;
+}
+
+}
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
@@ -0,0 +1,112 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef INCLUDED_IXION_DEPENDENCY_GRAPH_HPP
+#define INCLUDED_IXION_DEPENDENCY_GRAPH_HPP
+
+#include "ixion/address.hpp"
+
+#include <vector>
+
+namespace ixion {
+
+namespace iface {
+
+class formula_model_access;
+
+}
+
+/**
+ * Direct precedent-dependent relationships among the formula cells to be
+ * calculated in a single calculation run.  Each node is identified by its
+ * position in the sequence of formula cells passed to the constructor, and
+ * the relationships are stored in compressed sparse row format.
+ *
+ * The sequence of formula cells is expected to be topologically sorted.  An
+ * edge going from a node to another node that precedes it in the sequence
+ * can only be a part of a circular dependency.
+ */
+class dependency_graph
+{
+public:
+    using node_type = size_t;
+
+    class node_range
+    {
+        const node_type* m_begin;
+        const node_type* m_end;
+    public:
+        node_range(const node_type* _begin, const node_type* _end) :
+            m_begin(_begin), m_end(_end) {}
+
+        const node_type* begin() const { return m_begin; }
+        const node_type* end() const { return m_end; }
+        size_t size() const { return m_end - m_begin; }
+        bool empty() const { return m_begin == m_end; }
+    };
+
+private:
+    std::vector<size_t> m_offsets;
+    std::vector<node_type> m_dependents;
+    std::vector<size_t> m_precedent_counts;
+
+public:
+    dependency_graph() = delete;
+
+    /**
+     * Constructor.  It builds the graph from the dependency information
+     * stored in the cell tracker of the model.
+     *
+     * @param cxt model context.
+     * @param cells sorted sequence of formula cells and formula cell groups.
+     */
+    dependency_graph(const iface::formula_model_access& cxt, const std::vector<abs_range_t>& cells);
+
+    /**
+     * @return number of nodes in the graph.
+     */
+    size_t size() const;
+
+    /**
+     * Get all nodes that directly depend on a node.  The returned nodes are
+     * sorted in ascending order.
+     *
+     * @param node node to get the dependents of.
+     *
+     * @return range of dependent nodes.
+     */
+    node_range get_dependents(node_type node) const;
+
+    /**
+     * Get the number of precedents of a node that precede it in the
+     * sequence.  A node may only be calculated after all of these precedents
+     * have been calculated.
+     *
+     * @param node node to get the precedent count of.
+     *
+     * @return number of preceding precedents of the node.
+     */
+    size_t get_precedent_count(node_type node) const;
+
+    /**
+     * Find all nodes that are part of circular dependencies, as well as all
+     * nodes that depend on them either directly or indirectly.  It finds the
+     * strongly connected components of the graph using Tarjan's algorithm,
+     * thus it runs in linear time with respect to the number of nodes and
+     * edges.
+     *
+     * @return array of flags, one for each node.  A flag is set to true if
+     *         the node cannot be calculated due to circular dependency.
+     */
+    std::vector<bool> find_circular_nodes() const;
+};
+
+}
+
+#endif
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
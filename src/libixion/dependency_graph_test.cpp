@@ -0,0 +1,120 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "dependency_graph.hpp"
+
+#include <ixion/model_context.hpp>
+#include <ixion/dirty_cell_tracker.hpp>
+
+#include <cassert>
+#include <iostream>
+
+using namespace ixion;
+using namespace std;
+
+namespace {
+
+/**
+ * Create a sequence of single cells in column A, one for each node.
+ */
+std::vector<abs_range_t> create_cells(size_t n)
+{
+    std::vector<abs_range_t> cells;
+    for (size_t i = 0; i < n; ++i)
+        cells.emplace_back(0, i, 0);
+
+    return cells;
+}
+
+/**
+ * Make one node depend on another.
+ */
+void add_edge(model_context& cxt, const std::vector<abs_range_t>& cells, size_t pre, size_t dep)
+{
+    cxt.get_cell_tracker().add(cells[dep], cells[pre]);
+}
+
+}
+
+void test_no_cycle()
+{
+    cout << "--" << endl << __FUNCTION__ << endl;
+
+    model_context cxt;
+    std::vector<abs_range_t> cells = create_cells(4);
+
+    // 0 -> 1 -> 2, and 0 -> 3.
+    add_edge(cxt, cells, 0, 1);
+    add_edge(cxt, cells, 1, 2);
+    add_edge(cxt, cells, 0, 3);
+
+    dependency_graph graph(cxt, cells);
+    assert(graph.size() == 4);
+    assert(graph.get_dependents(0).size() == 2);
+    assert(graph.get_precedent_count(0) == 0);
+    assert(graph.get_precedent_count(2) == 1);
+
+    std::vector<bool> circular = graph.find_circular_nodes();
+    for (bool b : circular)
+        assert(!b);
+}
+
+void test_self_loop()
+{
+    cout << "--" << endl << __FUNCTION__ << endl;
+
+    model_context cxt;
+    std::vector<abs_range_t> cells = create_cells(4);
+
+    // 1 references itself, and 2 depends on it.  0 and 3 are unrelated.
+    add_edge(cxt, cells, 1, 1);
+    add_edge(cxt, cells, 1, 2);
+    add_edge(cxt, cells, 0, 3);
+
+    dependency_graph graph(cxt, cells);
+    std::vector<bool> circular = graph.find_circular_nodes();
+    assert(!circular[0]);
+    assert(circular[1]);
+    assert(circular[2]);
+    assert(!circular[3]);
+}
+
+void test_disjoint_cycles()
+{
+    cout << "--" << endl << __FUNCTION__ << endl;
+
+    model_context cxt;
+    std::vector<abs_range_t> cells = create_cells(8);
+
+    // 0 -> 1 -> 2 -> 0 and 4 -> 5 -> 4 are two separate cycles.  3 depends
+    // on the first cycle, 6 precedes the second one, and 7 is unrelated.
+    add_edge(cxt, cells, 0, 1);
+    add_edge(cxt, cells, 1, 2);
+    add_edge(cxt, cells, 2, 0);
+    add_edge(cxt, cells, 2, 3);
+    add_edge(cxt, cells, 4, 5);
+    add_edge(cxt, cells, 5, 4);
+    add_edge(cxt, cells, 6, 4);
+
+    dependency_graph graph(cxt, cells);
+    std::vector<bool> circular = graph.find_circular_nodes();
+
+    const bool expected[] = { true, true, true, true, true, true, false, false };
+    for (size_t i = 0; i < 8; ++i)
+        assert(circular[i] == expected[i]);
+}
+
+int main()
+{
+    test_no_cycle();
+    test_self_loop();
+    test_disjoint_cycles();
+
+    return EXIT_SUCCESS;
+}
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
@@ -13,8 +13,16 @@
 #include "debug.hpp"
 
 #include <mdds/rtree.hpp>
+#include <algorithm>
 #include <deque>
 #include <limits>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace ixion {
 
@@ -23,16 +31,525 @@ namespace {
 using rtree_type = mdds::rtree<rc_t, abs_range_set_t>;
 using rtree_array_type = std::deque<rtree_type>;
 
+/**
+ * Merge a collection of cell ranges into a smaller number of ranges that
+ * cover exactly the same cells, so that each of them can be looked up in
+ * the R-tree with a single search.  Single cells in the same column with
+ * consecutive rows are merged first, then the resulting runs that span the
+ * same rows in adjacent columns.  Multi-cell ranges are left unchanged.
+ *
+ * @param ranges cell ranges to merge.  The content gets replaced with the
+ *               merged ranges.
+ * @param buf buffer reused between calls to avoid repeated allocations.
+ */
+void coalesce_ranges(std::vector<abs_range_t>& ranges, std::vector<abs_range_t>& buf)
+{
+    if (ranges.size() < 2)
+        return;
+
+    // Move all single cells to the end.
+    auto it_cells = std::stable_partition(ranges.begin(), ranges.end(),
+        [](const abs_range_t& r) { return r.first != r.last || r.all_rows() || r.all_columns(); });
+
+    std::sort(it_cells, ranges.end(),
+        [](const abs_range_t& left, const abs_range_t& right)
+        {
+            return std::tie(left.first.sheet, left.first.column, left.first.row) <
+                std::tie(right.first.sheet, right.first.column, right.first.row);
+        }
+    );
+
+    // Merge the cells vertically.
+    buf.clear();
+    for (auto it = it_cells; it != ranges.end(); ++it)
+    {
+        const abs_address_t& cell = it->first;
+
+        if (!buf.empty())
+        {
+            abs_range_t& run = buf.back();
+            if (run.first.sheet == cell.sheet && run.first.column == cell.column)
+            {
+                if (run.last.row == cell.row)
+                    // Duplicate.
+                    continue;
+
+                if (run.last.row + 1 == cell.row)
+                {
+                    run.last.row = cell.row;
+                    continue;
+                }
+            }
+        }
+
+        buf.emplace_back(cell);
+    }
+
+    ranges.erase(it_cells, ranges.end());
+
+    // Merge the runs horizontally.
+    std::sort(buf.begin(), buf.end(),
+        [](const abs_range_t& left, const abs_range_t& right)
+        {
+            return std::tie(left.first.sheet, left.first.row, left.last.row, left.first.column) <
+                std::tie(right.first.sheet, right.first.row, right.last.row, right.first.column);
+        }
+    );
+
+    size_t n_ranges = ranges.size();
+    for (const abs_range_t& run : buf)
+    {
+        if (ranges.size() > n_ranges)
+        {
+            abs_range_t& block = ranges.back();
+            if (block.first.sheet == run.first.sheet &&
+                block.first.row == run.first.row && block.last.row == run.last.row &&
+                block.last.column + 1 == run.first.column)
+            {
+                block.last.column = run.first.column;
+                continue;
+            }
+        }
+
+        ranges.push_back(run);
+    }
+}
+
+/**
+ * Estimate the number of bytes used by a hash set, including its buckets.
+ */
+template<typename SetT>
+size_t estimate_set_bytes(const SetT& set)
+{
+    // Each element is stored in its own node together with a pointer to
+    // the next node and its cached hash value.
+    size_t node_size = sizeof(typename SetT::value_type) + sizeof(void*) + sizeof(size_t);
+    return sizeof(SetT) + set.bucket_count() * sizeof(void*) + set.size() * node_size;
+}
+
+/**
+ * Listeners of whole columns or whole rows on a single sheet, indexed by
+ * the interval of the columns or rows they reference.  The intervals are
+ * kept sorted by their start positions, and the length of the longest
+ * interval is tracked, so that all the intervals overlapping a given
+ * interval can be found in logarithmic time plus the number of intervals
+ * examined.  Most references are to a single column or row, which keeps
+ * the number of examined intervals close to the number of matches.
+ */
+class interval_listeners
+{
+    using key_type = std::pair<rc_t, rc_t>;
+    using map_type = std::map<key_type, abs_range_set_t>;
+
+    map_type m_map;
+
+    /** Largest difference between the end and the start of an interval. */
+    rc_t m_max_span;
+
+public:
+    interval_listeners() : m_max_span(0) {}
+
+    void add(rc_t first, rc_t last, const abs_range_t& src)
+    {
+        m_map[key_type(first, last)].insert(src);
+        m_max_span = std::max(m_max_span, last - first);
+    }
+
+    /**
+     * @return true if the listener has been removed, false if no such
+     *         listener exists.
+     */
+    bool remove(rc_t first, rc_t last, const abs_range_t& src)
+    {
+        auto it = m_map.find(key_type(first, last));
+        if (it == m_map.end())
+            return false;
+
+        bool removed = it->second.erase(src) > 0;
+        if (it->second.empty())
+            m_map.erase(it);
+
+        if (m_map.empty())
+            m_max_span = 0;
+
+        return removed;
+    }
+
+    /**
+     * Pass all the listeners of the intervals that overlap with a specified
+     * interval to a callback.
+     */
+    template<typename FuncT>
+    void for_each(rc_t first, rc_t last, FuncT func) const
+    {
+        // Only those intervals that start no earlier than this can reach the
+        // specified interval.
+        rc_t lowest_start = first > m_max_span ? first - m_max_span : 0;
+
+        auto it = m_map.lower_bound(key_type(lowest_start, 0));
+        for (; it != m_map.end() && it->first.first <= last; ++it)
+        {
+            if (it->first.second < first)
+                continue;
+
+            for (const abs_range_t& r : it->second)
+                func(r);
+        }
+    }
+
+    /**
+     * Pass each interval along with its listeners to a callback.
+     */
+    template<typename FuncT>
+    void for_each_interval(FuncT func) const
+    {
+        for (const auto& [key, listeners] : m_map)
+            func(key.first, key.second, listeners);
+    }
+
+    bool empty() const
+    {
+        return m_map.empty();
+    }
+
+    /**
+     * Add the number of listeners and an estimate of the memory used by
+     * them to the specified counters.
+     */
+    void add_usage(size_t& listeners, size_t& bytes) const
+    {
+        // Each interval is stored in a tree node along with three pointers
+        // and its color.
+        constexpr size_t node_size = sizeof(map_type::value_type) - sizeof(abs_range_set_t) + 4 * sizeof(void*);
+
+        for (const auto& entry : m_map)
+        {
+            listeners += entry.second.size();
+            bytes += node_size + estimate_set_bytes(entry.second);
+        }
+    }
+};
+
+using interval_listeners_array_type = std::deque<interval_listeners>;
+
+/**
+ * Rectangle covered by a range on one sheet, with the unset rows and
+ * columns expanded to the whole sheet.
+ */
+struct range_extent
+{
+    rc_t row1;
+    rc_t row2;
+    rc_t col1;
+    rc_t col2;
+
+    range_extent(const abs_range_t& range) :
+        row1(range.first.row), row2(range.last.row),
+        col1(range.first.column), col2(range.last.column)
+    {
+        if (range.all_rows())
+        {
+            row1 = 0;
+            row2 = std::numeric_limits<rc_t>::max();
+        }
+
+        if (range.all_columns())
+        {
+            col1 = 0;
+            col2 = std::numeric_limits<rc_t>::max();
+        }
+    }
+};
+
+/**
+ * Listener that represents a column of formula cells that all reference the
+ * same range relative to their own positions, as is typical for a formula
+ * filled down across many rows.  The destination range of each formula cell
+ * is only computed when the listener is queried.
+ */
+struct relative_listener
+{
+    /** Column of formula cells that share the same relative reference. */
+    abs_range_t src;
+
+    /** Reference relative to each formula cell in the column. */
+    range_t dest;
+
+    relative_listener(const abs_range_t& _src, const range_t& _dest) :
+        src(_src), dest(_dest) {}
+
+    /**
+     * Get the destination range of the formula cell at a specified row
+     * offset from the top of the column.
+     */
+    range_extent get_dest(rc_t offset) const
+    {
+        abs_address_t origin = src.first;
+        origin.row += offset;
+        abs_range_t range = dest.to_abs(origin);
+        range.reorder();
+        return range_extent(range);
+    }
+
+    /**
+     * Get the first and last sheets the destination range is on.
+     */
+    std::pair<sheet_t, sheet_t> get_dest_sheets() const
+    {
+        abs_range_t range = dest.to_abs(src.first);
+        return { range.first.sheet, range.last.sheet };
+    }
+
+    /**
+     * Get the rectangle covered by the destination ranges of all the
+     * formula cells.
+     */
+    range_extent get_dest_extent() const
+    {
+        range_extent ext = get_dest(0);
+        ext.row2 = get_dest(src.last.row - src.first.row).row2;
+        return ext;
+    }
+
+    /**
+     * Pass each formula cell whose destination range overlaps with a
+     * specified rectangle to a callback.
+     */
+    template<typename FuncT>
+    void for_each_cell(const range_extent& ext, FuncT func) const
+    {
+        // All formula cells are in the same column, so the columns of their
+        // destination ranges are all the same.
+        range_extent top = get_dest(0);
+        if (top.col2 < ext.col1 || ext.col2 < top.col1)
+            return;
+
+        // Neither end row of the destination range decreases as the row
+        // offset increases, so the formula cells whose destination ranges
+        // overlap with the rows form a contiguous run.
+        rc_t n = src.last.row - src.first.row + 1;
+
+        auto find_first = [n](auto pred)
+        {
+            rc_t lo = 0, hi = n;
+            while (lo < hi)
+            {
+                rc_t mid = lo + (hi - lo) / 2;
+                if (pred(mid))
+                    hi = mid;
+                else
+                    lo = mid + 1;
+            }
+            return lo;
+        };
+
+        rc_t begin = find_first([&](rc_t i) { return get_dest(i).row2 >= ext.row1; });
+        rc_t end = find_first([&](rc_t i) { return get_dest(i).row1 > ext.row2; });
+
+        for (rc_t i = begin; i < end; ++i)
+            func(abs_range_t(src.first.sheet, src.first.row + i, src.first.column));
+    }
+
+    struct hash
+    {
+        size_t operator() (const relative_listener& rl) const
+        {
+            return abs_range_t::hash()(rl.src) + 65536 * range_t::hash()(rl.dest);
+        }
+    };
+};
+
+bool operator==(const relative_listener& left, const relative_listener& right)
+{
+    return left.src == right.src && left.dest == right.dest;
+}
+
+using relative_listener_set_t = std::unordered_set<relative_listener, relative_listener::hash>;
+using relative_rtree_type = mdds::rtree<rc_t, relative_listener_set_t>;
+using relative_rtree_array_type = std::deque<relative_rtree_type>;
+
+/**
+ * Identifies the formula cells in one column of one sheet that reference
+ * the same range relative to their own positions.
+ */
+struct relative_block_key
+{
+    sheet_t sheet;
+    col_t column;
+    range_t dest;
+
+    relative_block_key(sheet_t _sheet, col_t _column, const range_t& _dest) :
+        sheet(_sheet), column(_column), dest(_dest) {}
+
+    struct hash
+    {
+        size_t operator() (const relative_block_key& key) const
+        {
+            return key.sheet + 256 * key.column + 65536 * range_t::hash()(key.dest);
+        }
+    };
+};
+
+bool operator==(const relative_block_key& left, const relative_block_key& right)
+{
+    return left.sheet == right.sheet && left.column == right.column && left.dest == right.dest;
+}
+
+/**
+ * Blocks of consecutive rows of formula cells for each key, stored as
+ * pairs of their first and last rows.  The blocks of the same key never
+ * overlap nor touch one another.
+ */
+using relative_blocks_type = std::unordered_map<
+    relative_block_key, std::map<rc_t, rc_t>, relative_block_key::hash>;
+
+relative_rtree_type::extent_type to_extent(const range_extent& ext)
+{
+    return {{ext.row1, ext.col1}, {ext.row2, ext.col2}};
+}
+
+/**
+ * Minimum number of entries that need to be erased from an R-tree before
+ * it gets rebuilt, so that small trees don't get rebuilt over and over.
+ */
+constexpr size_t compact_min_erased = 1024;
+
+/**
+ * An R-tree gets rebuilt once the number of entries erased from it since
+ * it was last built reaches this ratio of the number of remaining entries.
+ * Erasing entries leaves its nodes underfilled and their extents loose,
+ * which makes the searches visit more nodes than necessary.
+ */
+constexpr double compact_erase_ratio = 0.5;
+
+/**
+ * Rebuild an R-tree from its current entries in one go, which packs the
+ * nodes as tightly as possible.
+ */
+template<typename TreeT>
+void rebuild_tree(TreeT& tree)
+{
+    rc_t max_val = std::numeric_limits<rc_t>::max();
+
+    typename TreeT::bulk_loader loader;
+    typename TreeT::search_results res =
+        tree.search({{0, 0}, {max_val, max_val}}, TreeT::search_type::overlap);
+
+    for (auto it = res.begin(); it != res.end(); ++it)
+    {
+        typename TreeT::extent_type ext = it.extent();
+        loader.insert(ext, std::move(*it));
+    }
+
+    tree = loader.pack();
+}
+
+/**
+ * Estimate the memory used by an R-tree along with the listener sets
+ * stored in it, and add it to the memory usage of a sheet.
+ */
+template<typename TreeT>
+void add_tree_usage(const TreeT& tree, dirty_cell_tracker::sheet_memory_usage& usage)
+{
+    // Each node stores its extent, its type, a pointer to its parent and
+    // a pointer to either its child nodes or its value.
+    constexpr size_t node_size = sizeof(typename TreeT::extent_type) + 3 * sizeof(void*);
+
+    tree.walk(
+        [&](const typename TreeT::node_properties& np)
+        {
+            usage.bytes += node_size;
+
+            if (np.type != TreeT::node_type::value)
+                ++usage.tree_nodes;
+        }
+    );
+
+    rc_t max_val = std::numeric_limits<rc_t>::max();
+    typename TreeT::const_search_results res =
+        tree.search({{0, 0}, {max_val, max_val}}, TreeT::search_type::overlap);
+
+    for (const auto& listeners : res)
+    {
+        ++usage.tree_entries;
+        usage.listeners += listeners.size();
+        usage.bytes += estimate_set_bytes(listeners);
+    }
+}
+
 } // anonymous namespace
 
 struct dirty_cell_tracker::impl
 {
     rtree_array_type m_grids;
+
+    /**
+     * Listeners of whole columns, which are kept out of the R-tree since
+     * their very tall rectangles would overlap with one another and match
+     * almost every search.
+     */
+    interval_listeners_array_type m_column_listeners;
+
+    /**
+     * Listeners of whole rows, for the same reason.
+     */
+    interval_listeners_array_type m_row_listeners;
+
+    /**
+     * Relative listeners indexed by the rectangles covered by their
+     * destination ranges.
+     */
+    relative_rtree_array_type m_relative_grids;
+
+    /**
+     * Relative listeners by their source columns and relative references,
+     * used to grow, shrink and split them as formula cells come and go.
+     */
+    relative_blocks_type m_relative_blocks;
+
+    /**
+     * Number of entries erased from each R-tree in m_grids since the tree
+     * was last built.
+     */
+    std::deque<size_t> m_erased_counts;
+
+    /**
+     * Same as m_erased_counts, for the R-trees in m_relative_grids.
+     */
+    std::deque<size_t> m_relative_erased_counts;
+
     abs_range_set_t m_volatile_cells;
 
+    /**
+     * Pairs of source and destination ranges collected in bulk-load mode.
+     */
+    std::vector<std::pair<abs_range_t, abs_range_t>> m_bulk_pairs;
+    bool m_bulk_mode;
+
+    /**
+     * Whether any relative listener has been added in bulk-load mode, in
+     * which case the R-trees of the relative listeners get rebuilt at the
+     * end.
+     */
+    bool m_bulk_relative;
+
     mutable std::unique_ptr<formula_name_resolver> m_resolver;
 
-    impl() {}
+    impl() : m_bulk_mode(false), m_bulk_relative(false) {}
+
+    /**
+     * Throw if in bulk-load mode, in which the collected relationships are
+     * not yet visible to queries and removals.
+     */
+    void check_not_bulk_mode(const char* func) const
+    {
+        if (m_bulk_mode)
+        {
+            std::ostringstream os;
+            os << "dirty_cell_tracker::" << func << ": not allowed in bulk-load mode.";
+            throw std::logic_error(os.str());
+        }
+    }
 
     rtree_type& fetch_grid_or_resize(size_t n)
     {
@@ -52,6 +569,242 @@ struct dirty_cell_tracker::impl
         return (n < m_grids.size()) ? &m_grids[n] : nullptr;
     }
 
+    /**
+     * Record an entry erased from an R-tree, and rebuild the tree once
+     * enough entries have been erased from it.
+     */
+    template<typename TreeT>
+    void on_erase(TreeT& tree, std::deque<size_t>& erased_counts, size_t sheet)
+    {
+        if (erased_counts.size() <= sheet)
+            erased_counts.resize(sheet+1);
+
+        size_t& erased = erased_counts[sheet];
+        ++erased;
+
+        if (erased >= compact_min_erased && erased >= tree.size() * compact_erase_ratio)
+        {
+            rebuild_tree(tree);
+            erased = 0;
+        }
+    }
+
+    relative_listener make_relative_listener(const relative_block_key& key, rc_t row1, rc_t row2) const
+    {
+        abs_range_t src(key.sheet, row1, key.column, row2 - row1 + 1, 1);
+        return relative_listener(src, key.dest);
+    }
+
+    void insert_relative_listener(const relative_listener& rl)
+    {
+        relative_rtree_type::extent_type box = to_extent(rl.get_dest_extent());
+        auto [sheet1, sheet2] = rl.get_dest_sheets();
+
+        for (sheet_t sheet = sheet1; sheet <= sheet2; ++sheet)
+        {
+            if (m_relative_grids.size() <= size_t(sheet))
+                m_relative_grids.resize(sheet+1);
+
+            relative_rtree_type& tree = m_relative_grids[sheet];
+            relative_rtree_type::search_results res = tree.search(box, relative_rtree_type::search_type::match);
+
+            if (res.begin() == res.end())
+            {
+                relative_listener_set_t listener;
+                listener.insert(rl);
+                tree.insert(box, std::move(listener));
+            }
+            else
+                res.begin()->insert(rl);
+        }
+    }
+
+    void erase_relative_listener(const relative_listener& rl)
+    {
+        relative_rtree_type::extent_type box = to_extent(rl.get_dest_extent());
+        auto [sheet1, sheet2] = rl.get_dest_sheets();
+
+        for (sheet_t sheet = sheet1; sheet <= sheet2 && size_t(sheet) < m_relative_grids.size(); ++sheet)
+        {
+            relative_rtree_type& tree = m_relative_grids[sheet];
+            relative_rtree_type::search_results res = tree.search(box, relative_rtree_type::search_type::match);
+
+            if (res.begin() == res.end())
+                continue;
+
+            relative_rtree_type::iterator it_listener = res.begin();
+            it_listener->erase(rl);
+            if (it_listener->empty())
+            {
+                tree.erase(it_listener);
+                on_erase(tree, m_relative_erased_counts, sheet);
+            }
+        }
+    }
+
+    /**
+     * Add a block of formula cells to the relative listeners, merging it
+     * with the existing blocks that overlap with or are adjacent to it.
+     */
+    void add_relative_block(const relative_block_key& key, rc_t row1, rc_t row2)
+    {
+        std::map<rc_t, rc_t>& blocks = m_relative_blocks[key];
+
+        auto it = blocks.upper_bound(row2 + 1);
+        while (it != blocks.begin())
+        {
+            auto prev = std::prev(it);
+            if (prev->second + 1 < row1)
+                break;
+
+            if (!m_bulk_mode)
+                erase_relative_listener(make_relative_listener(key, prev->first, prev->second));
+
+            row1 = std::min(row1, prev->first);
+            row2 = std::max(row2, prev->second);
+            it = blocks.erase(prev);
+        }
+
+        blocks.emplace(row1, row2);
+
+        if (m_bulk_mode)
+            m_bulk_relative = true;
+        else
+            insert_relative_listener(make_relative_listener(key, row1, row2));
+    }
+
+    /**
+     * Remove a block of formula cells from the relative listeners, splitting
+     * the existing blocks that partially overlap with it.
+     *
+     * @return true if at least one formula cell has been removed, false
+     *         otherwise.
+     */
+    bool remove_relative_block(const relative_block_key& key, rc_t row1, rc_t row2)
+    {
+        auto it_blocks = m_relative_blocks.find(key);
+        if (it_blocks == m_relative_blocks.end())
+            return false;
+
+        std::map<rc_t, rc_t>& blocks = it_blocks->second;
+        std::vector<std::pair<rc_t, rc_t>> remaining;
+        bool removed = false;
+
+        auto it = blocks.upper_bound(row2);
+        while (it != blocks.begin())
+        {
+            auto prev = std::prev(it);
+            if (prev->second < row1)
+                break;
+
+            erase_relative_listener(make_relative_listener(key, prev->first, prev->second));
+
+            if (prev->first < row1)
+                remaining.emplace_back(prev->first, row1 - 1);
+            if (row2 < prev->second)
+                remaining.emplace_back(row2 + 1, prev->second);
+
+            it = blocks.erase(prev);
+            removed = true;
+        }
+
+        for (const auto& [first, last] : remaining)
+        {
+            blocks.emplace(first, last);
+            insert_relative_listener(make_relative_listener(key, first, last));
+        }
+
+        if (blocks.empty())
+            m_relative_blocks.erase(it_blocks);
+
+        return removed;
+    }
+
+    /**
+     * Rebuild the R-trees of all relative listeners from their blocks.
+     */
+    void rebuild_relative_grids()
+    {
+        using listeners_type = std::unordered_map<abs_range_t, relative_listener_set_t, abs_range_t::hash>;
+        std::map<sheet_t, listeners_type> sheet_listeners;
+
+        for (const auto& [key, blocks] : m_relative_blocks)
+        {
+            for (const auto& [row1, row2] : blocks)
+            {
+                relative_listener rl = make_relative_listener(key, row1, row2);
+                range_extent ext = rl.get_dest_extent();
+                auto [sheet1, sheet2] = rl.get_dest_sheets();
+
+                for (sheet_t sheet = sheet1; sheet <= sheet2; ++sheet)
+                {
+                    abs_range_t box;
+                    box.first = abs_address_t(sheet, ext.row1, ext.col1);
+                    box.last = abs_address_t(sheet, ext.row2, ext.col2);
+                    sheet_listeners[sheet][box].insert(rl);
+                }
+            }
+        }
+
+        m_relative_grids.clear();
+        m_relative_erased_counts.clear();
+
+        for (auto& [sheet, listeners] : sheet_listeners)
+        {
+            relative_rtree_type::bulk_loader loader;
+            for (auto& [box, rls] : listeners)
+            {
+                relative_rtree_type::extent_type ext(
+                    {{box.first.row, box.first.column}, {box.last.row, box.last.column}});
+                loader.insert(ext, std::move(rls));
+            }
+
+            if (m_relative_grids.size() <= size_t(sheet))
+                m_relative_grids.resize(sheet+1);
+
+            m_relative_grids[sheet] = loader.pack();
+        }
+    }
+
+    /**
+     * Get the interval listeners a destination range belongs to, if the
+     * range covers whole columns or whole rows.
+     *
+     * @param dest destination range.
+     * @param sheet sheet index.
+     * @param first (output) first column or row of the interval.
+     * @param last (output) last column or row of the interval.
+     *
+     * @return pointer to the interval listeners, or nullptr if the range is
+     *         to be stored in the R-tree.
+     */
+    interval_listeners* fetch_interval_listeners(
+        const abs_range_t& dest, sheet_t sheet, rc_t& first, rc_t& last)
+    {
+        range_extent ext(dest);
+
+        interval_listeners_array_type* store = nullptr;
+        if (dest.all_rows())
+        {
+            store = &m_column_listeners;
+            first = ext.col1;
+            last = ext.col2;
+        }
+        else if (dest.all_columns())
+        {
+            store = &m_row_listeners;
+            first = ext.row1;
+            last = ext.row2;
+        }
+        else
+            return nullptr;
+
+        if (store->size() <= size_t(sheet))
+            store->resize(sheet+1);
+
+        return &(*store)[sheet];
+    }
+
     /**
      * Given a modified cell range, return all ranges that are directly
      * affected by it.
@@ -63,20 +816,52 @@ struct dirty_cell_tracker::impl
      */
     abs_range_set_t get_affected_cell_ranges(const abs_range_t& range) const
     {
-        const rtree_type* grid = fetch_grid(range.first.sheet);
+        abs_range_set_t ranges;
+        for_each_affected_cell_range(range, [&ranges](const abs_range_t& r) { ranges.insert(r); });
+        return ranges;
+    }
+
+    /**
+     * Same as get_affected_cell_ranges(), except that each affected range
+     * gets passed to a callback without being collected.  The same range
+     * may be passed more than once.
+     */
+    template<typename FuncT>
+    void for_each_affected_cell_range(const abs_range_t& range, FuncT func) const
+    {
+        size_t sheet = range.first.sheet;
+        range_extent ext(range);
+
+        if (sheet < m_column_listeners.size())
+            m_column_listeners[sheet].for_each(ext.col1, ext.col2, func);
+
+        if (sheet < m_row_listeners.size())
+            m_row_listeners[sheet].for_each(ext.row1, ext.row2, func);
+
+        if (sheet < m_relative_grids.size())
+        {
+            relative_rtree_type::const_search_results res = m_relative_grids[sheet].search(
+                to_extent(ext), relative_rtree_type::search_type::overlap);
+
+            for (const relative_listener_set_t& rls : res)
+            {
+                for (const relative_listener& rl : rls)
+                    rl.for_each_cell(ext, func);
+            }
+        }
+
+        const rtree_type* grid = fetch_grid(sheet);
         if (!grid)
-            return abs_range_set_t();
+            return;
 
         rtree_type::const_search_results res = grid->search(
-            {{range.first.row, range.first.column}, {range.last.row, range.last.column}},
-            rtree_type::search_type::overlap);
-
-        abs_range_set_t ranges;
+            {{ext.row1, ext.col1}, {ext.row2, ext.col2}}, rtree_type::search_type::overlap);
 
         for (const abs_range_set_t& range_set : res)
-            ranges.insert(range_set.begin(), range_set.end());
-
-        return ranges;
+        {
+            for (const abs_range_t& r : range_set)
+                func(r);
+        }
     }
 
     std::string print(const abs_range_t& range) const
@@ -122,9 +907,21 @@ void dirty_cell_tracker::add(const abs_range_t& src, const abs_range_t& dest)
 
     if (dest.all_columns() || dest.all_rows())
     {
-        std::ostringstream os;
-        os << "dirty_cell_tracker::add: unset column or row range is not allowed " << dest;
-        throw std::invalid_argument(os.str());
+        // Whole columns or rows go to the interval listeners.
+        for (sheet_t sheet = dest.first.sheet; sheet <= dest.last.sheet; ++sheet)
+        {
+            rc_t first = 0, last = 0;
+            interval_listeners* listeners = mp_impl->fetch_interval_listeners(dest, sheet, first, last);
+            listeners->add(first, last, src);
+        }
+
+        return;
+    }
+
+    if (mp_impl->m_bulk_mode)
+    {
+        mp_impl->m_bulk_pairs.emplace_back(src, dest);
+        return;
     }
 
     for (sheet_t sheet = dest.first.sheet; sheet <= dest.last.sheet; ++sheet)
@@ -152,6 +949,126 @@ void dirty_cell_tracker::add(const abs_range_t& src, const abs_range_t& dest)
     }
 }
 
+void dirty_cell_tracker::add_relative(const abs_range_t& src, const range_t& dest)
+{
+    if (!src.valid() || src.first.sheet != src.last.sheet ||
+        src.first.column != src.last.column || src.all_rows())
+    {
+        // source range must be a single column of cells on one sheet.
+        std::ostringstream os;
+        os << "dirty_cell_tracker::add_relative: invalid source range: src=" << src;
+        throw std::invalid_argument(os.str());
+    }
+
+    if (!dest.to_abs(src.first).valid() || !dest.to_abs(src.last).valid())
+    {
+        std::ostringstream os;
+        os << "dirty_cell_tracker::add_relative: invalid destination range: src=" << src << "; dest=" << dest;
+        throw std::invalid_argument(os.str());
+    }
+
+    relative_block_key key(src.first.sheet, src.first.column, dest);
+    mp_impl->add_relative_block(key, src.first.row, src.last.row);
+}
+
+void dirty_cell_tracker::remove_relative(const abs_range_t& src, const range_t& dest)
+{
+    if (!src.valid() || src.first.sheet != src.last.sheet ||
+        src.first.column != src.last.column || src.all_rows())
+    {
+        // source range must be a single column of cells on one sheet.
+        std::ostringstream os;
+        os << "dirty_cell_tracker::remove_relative: invalid source range: src=" << src;
+        throw std::invalid_argument(os.str());
+    }
+
+    mp_impl->check_not_bulk_mode("remove_relative");
+
+    relative_block_key key(src.first.sheet, src.first.column, dest);
+    if (!mp_impl->remove_relative_block(key, src.first.row, src.last.row))
+    {
+        IXION_DEBUG(src << " was not tracking " << dest << " relative to itself.");
+    }
+}
+
+void dirty_cell_tracker::begin_bulk_add()
+{
+    mp_impl->m_bulk_mode = true;
+}
+
+void dirty_cell_tracker::end_bulk_add()
+{
+    if (!mp_impl->m_bulk_mode)
+        return;
+
+    mp_impl->m_bulk_mode = false;
+
+    if (mp_impl->m_bulk_relative)
+    {
+        mp_impl->m_bulk_relative = false;
+        mp_impl->rebuild_relative_grids();
+    }
+
+    std::vector<std::pair<abs_range_t, abs_range_t>> pairs;
+    pairs.swap(mp_impl->m_bulk_pairs);
+
+    if (pairs.empty())
+        return;
+
+    // Group the source ranges by their destination ranges, for each sheet.
+    using listeners_type = std::unordered_map<abs_range_t, abs_range_set_t, abs_range_t::hash>;
+    std::map<sheet_t, listeners_type> sheet_listeners;
+
+    for (const auto& [src, dest] : pairs)
+    {
+        for (sheet_t sheet = dest.first.sheet; sheet <= dest.last.sheet; ++sheet)
+        {
+            abs_range_t key = dest;
+            key.first.sheet = key.last.sheet = sheet;
+            sheet_listeners[sheet][key].insert(src);
+        }
+    }
+
+    rc_t max_val = std::numeric_limits<rc_t>::max();
+
+    for (auto& [sheet, listeners] : sheet_listeners)
+    {
+        rtree_type& tree = mp_impl->fetch_grid_or_resize(sheet);
+
+        // Carry over the listeners already in the tree.
+        rtree_type::search_results res =
+            tree.search({{0, 0}, {max_val, max_val}}, rtree_type::search_type::overlap);
+
+        for (auto it = res.begin(); it != res.end(); ++it)
+        {
+            const rtree_type::extent_type& ext = it.extent();
+            abs_range_t key;
+            key.first = abs_address_t(sheet, ext.start.d[0], ext.start.d[1]);
+            key.last = abs_address_t(sheet, ext.end.d[0], ext.end.d[1]);
+
+            abs_range_set_t& srcs = listeners[key];
+            if (srcs.empty())
+                srcs.swap(*it);
+            else
+                srcs.insert(it->begin(), it->end());
+        }
+
+        // Build a new tree with all listeners in one go.
+        rtree_type::bulk_loader loader;
+        for (auto& [dest, srcs] : listeners)
+        {
+            rtree_type::extent_type box(
+                {{dest.first.row, dest.first.column}, {dest.last.row, dest.last.column}});
+            loader.insert(box, std::move(srcs));
+        }
+
+        tree = loader.pack();
+
+        if (size_t(sheet) < mp_impl->m_erased_counts.size())
+            mp_impl->m_erased_counts[sheet] = 0;
+    }
+}
+
 void dirty_cell_tracker::remove(const abs_range_t& src, const abs_range_t& dest)
 {
     if (!src.valid() || src.first.sheet != src.last.sheet)
@@ -169,11 +1086,21 @@ void dirty_cell_tracker::remove(const abs_range_t& src, const abs_range_t& dest)
         throw std::invalid_argument(os.str());
     }
 
+    mp_impl->check_not_bulk_mode("remove");
+
     if (dest.all_columns() || dest.all_rows())
     {
-        std::ostringstream os;
-        os << "dirty_cell_tracker::remove: unset column or row range is not allowed " << dest;
-        throw std::invalid_argument(os.str());
+        for (sheet_t sheet = dest.first.sheet; sheet <= dest.last.sheet; ++sheet)
+        {
+            rc_t first = 0, last = 0;
+            interval_listeners* listeners = mp_impl->fetch_interval_listeners(dest, sheet, first, last);
+            if (!listeners->remove(first, last, src))
+            {
+                IXION_DEBUG(src << " was not tracking " << dest << " on sheet " << sheet << ".");
+            }
+        }
+
+        return;
     }
 
     for (sheet_t sheet = dest.first.sheet; sheet <= dest.last.sheet; ++sheet)
@@ -207,8 +1134,11 @@ void dirty_cell_tracker::remove(const abs_range_t& src, const abs_range_t& dest)
         }
 
         if (listener.empty())
+        {
             // Remove this from the R-tree.
             tree->erase(it_listener);
+            mp_impl->on_erase(*tree, mp_impl->m_erased_counts, sheet);
+        }
     }
 }
 
@@ -222,6 +1152,11 @@ void dirty_cell_tracker::remove_volatile(const abs_range_t& pos)
     mp_impl->m_volatile_cells.erase(pos);
 }
 
+bool dirty_cell_tracker::is_volatile(const abs_range_t& pos) const
+{
+    return mp_impl->m_volatile_cells.count(pos) > 0;
+}
+
 abs_range_set_t dirty_cell_tracker::query_dirty_cells(const abs_range_t& modified_cell) const
 {
     abs_range_set_t mod_cells;
@@ -231,6 +1166,8 @@ abs_range_set_t dirty_cell_tracker::query_dirty_cells(const abs_range_t& modifie
 
 abs_range_set_t dirty_cell_tracker::query_dirty_cells(const abs_range_set_t& modified_cells) const
 {
+    mp_impl->check_not_bulk_mode("query_dirty_cells");
+
     abs_range_set_t dirty_formula_cells;
 
     // Volatile cells are in theory always formula cells and therefore always
@@ -238,33 +1175,45 @@ abs_range_set_t dirty_cell_tracker::query_dirty_cells(const abs_range_set_t& mod
     dirty_formula_cells.insert(
         mp_impl->m_volatile_cells.begin(), mp_impl->m_volatile_cells.end());
 
-    abs_range_set_t cur_modified_cells = modified_cells;
-    for (const abs_range_t& r : mp_impl->m_volatile_cells)
-        cur_modified_cells.insert(r);
+    // The dirty formula cells also serve as the set of visited ranges, so
+    // that each round only needs a plain array of the newly found ranges.
+    std::vector<abs_range_t> cur_modified_cells(modified_cells.begin(), modified_cells.end());
+    cur_modified_cells.insert(
+        cur_modified_cells.end(), mp_impl->m_volatile_cells.begin(), mp_impl->m_volatile_cells.end());
+
+    std::vector<abs_range_t> next_modified_cells;
+    std::vector<abs_range_t> buf;
+
+    auto func = [&](const abs_range_t& r)
+    {
+        auto res = dirty_formula_cells.insert(r);
+        if (res.second)
+            // This affected range has not yet been visited.  Put it in the
+            // chain for the next round of checks.
+            next_modified_cells.push_back(r);
+    };
 
     while (!cur_modified_cells.empty())
     {
-        abs_range_set_t next_modified_cells;
+        // Search the R-tree once per merged range rather than once per cell.
+        coalesce_ranges(cur_modified_cells, buf);
 
         for (const abs_range_t& mc : cur_modified_cells)
-        {
-            abs_range_set_t affected_ranges = mp_impl->get_affected_cell_ranges(mc);
-            for (const abs_range_t& r : affected_ranges)
-            {
-                auto res = dirty_formula_cells.insert(r);
-                if (res.second)
-                    // This affected range has not yet been visited.  Put it
-                    // in the chain for the next round of checks.
-                    next_modified_cells.insert(r);
-            }
-        }
+            mp_impl->for_each_affected_cell_range(mc, func);
 
         cur_modified_cells.swap(next_modified_cells);
+        next_modified_cells.clear();
     }
 
     return dirty_formula_cells;
 }
 
+abs_range_set_t dirty_cell_tracker::query_direct_dependents(const abs_range_t& range) const
+{
+    mp_impl->check_not_bulk_mode("query_direct_dependents");
+    return mp_impl->get_affected_cell_ranges(range);
+}
+
 std::vector<abs_range_t> dirty_cell_tracker::query_and_sort_dirty_cells(const abs_range_t& modified_cell) const
 {
     abs_range_set_t mod_cells;
@@ -275,62 +1224,82 @@ std::vector<abs_range_t> dirty_cell_tracker::query_and_sort_dirty_cells(const ab
 std::vector<abs_range_t> dirty_cell_tracker::query_and_sort_dirty_cells(
     const abs_range_set_t& modified_cells, const abs_range_set_t* dirty_formula_cells) const
 {
-    abs_range_set_t cur_modified_cells = modified_cells;
+    mp_impl->check_not_bulk_mode("query_and_sort_dirty_cells");
+
+    std::vector<abs_range_t> cur_modified_cells(modified_cells.begin(), modified_cells.end());
+    std::vector<abs_range_t> next_modified_cells;
 
     abs_range_set_t final_dirty_formula_cells;
 
     // Get the initial set of formula cells affected by the modified cells.
-    // Note that these modified cells are not dirty formula cells.
+    // Note that these modified cells are not dirty formula cells, so they
+    // can be merged before searching the R-tree.
     if (!cur_modified_cells.empty())
     {
-        abs_range_set_t next_modified_cells;
+        std::vector<abs_range_t> buf;
+        coalesce_ranges(cur_modified_cells, buf);
+
         for (const abs_range_t& mc : cur_modified_cells)
         {
-            for (const abs_range_t& r : mp_impl->get_affected_cell_ranges(mc))
-            {
-                auto res = final_dirty_formula_cells.insert(r);
-                if (res.second)
-                    // This affected range has not yet been visited.  Put it
-                    // in the chain for the next round of checks.
-                    next_modified_cells.insert(r);
-            }
+            mp_impl->for_each_affected_cell_range(mc,
+                [&](const abs_range_t& r)
+                {
+                    auto res = final_dirty_formula_cells.insert(r);
+                    if (res.second)
+                        // This affected range has not yet been visited.  Put
+                        // it in the chain for the next round of checks.
+                        next_modified_cells.push_back(r);
+                }
+            );
         }
 
         cur_modified_cells.swap(next_modified_cells);
+        next_modified_cells.clear();
     }
 
     // Because the modified cells in the subsequent rounds are all dirty
     // formula cells, we need to track precedent-dependent relationships for
     // later sorting.
 
-    cur_modified_cells.insert(mp_impl->m_volatile_cells.begin(), mp_impl->m_volatile_cells.end());
+    cur_modified_cells.insert(
+        cur_modified_cells.end(), mp_impl->m_volatile_cells.begin(), mp_impl->m_volatile_cells.end());
 
     if (dirty_formula_cells)
-        cur_modified_cells.insert(dirty_formula_cells->begin(), dirty_formula_cells->end());
+        cur_modified_cells.insert(
+            cur_modified_cells.end(), dirty_formula_cells->begin(), dirty_formula_cells->end());
+
+    // Remove the duplicates, which the sets used to take care of.
+    std::sort(cur_modified_cells.begin(), cur_modified_cells.end());
+    cur_modified_cells.erase(
+        std::unique(cur_modified_cells.begin(), cur_modified_cells.end()), cur_modified_cells.end());
 
     using dfs_type = depth_first_search<abs_range_t, abs_range_t::hash>;
     dfs_type::relations rels;
 
     while (!cur_modified_cells.empty())
     {
-        abs_range_set_t next_modified_cells;
         for (const abs_range_t& mc : cur_modified_cells)
         {
-            for (const abs_range_t& r : mp_impl->get_affected_cell_ranges(mc))
-            {
-                // Record each precedent-dependent relationship (r =
-                // precedent; mc = dependent).
-                rels.insert(r, mc);
-
-                auto res = final_dirty_formula_cells.insert(r);
-                if (res.second)
-                    // This affected range has not yet been visited.  Put it
-                    // in the chain for the next round of checks.
-                    next_modified_cells.insert(r);
-            }
+            size_t mc_id = rels.get_id(mc);
+
+            mp_impl->for_each_affected_cell_range(mc,
+                [&](const abs_range_t& r)
+                {
+                    // Record each precedent-dependent relationship (r =
+                    // precedent; mc = dependent).
+                    rels.insert_by_id(rels.get_id(r), mc_id);
+
+                    auto res = final_dirty_formula_cells.insert(r);
+                    if (res.second)
+                        // This affected range has not yet been visited.  Put
+                        // it in the chain for the next round of checks.
+                        next_modified_cells.push_back(r);
+                }
+            );
         }
 
         cur_modified_cells.swap(next_modified_cells);
+        next_modified_cells.clear();
     }
 
     // Volatile cells are always formula cells and therefore always should be
@@ -391,6 +1360,64 @@ std::string dirty_cell_tracker::to_string() const
         }
     }
 
+    auto print_intervals = [&](const interval_listeners_array_type& store, bool columns)
+    {
+        for (sheet_t i = 0, n = store.size(); i < n; ++i)
+        {
+            store[i].for_each_interval(
+                [&](rc_t first, rc_t last, const abs_range_set_t& srcs)
+                {
+                    abs_range_t dest(i, 0, 0);
+                    if (columns)
+                    {
+                        dest.set_all_rows();
+                        dest.first.column = first;
+                        dest.last.column = last;
+                    }
+                    else
+                    {
+                        dest.set_all_columns();
+                        dest.first.row = first;
+                        dest.last.row = last;
+                    }
+
+                    range_t rdest = dest;
+                    rdest.set_absolute(false);
+                    std::string dest_name = resolver->get_name(rdest, origin, false);
+
+                    for (const abs_range_t& src : srcs)
+                    {
+                        std::ostringstream os;
+                        os << mp_impl->print(src);
+                        os << " -> Sheet" << (i+1) << '!' << dest_name;
+                        lines.push_back(os.str());
+                    }
+                }
+            );
+        }
+    };
+
+    print_intervals(mp_impl->m_column_listeners, true);
+    print_intervals(mp_impl->m_row_listeners, false);
+
+    for (const auto& [key, blocks] : mp_impl->m_relative_blocks)
+    {
+        for (const auto& [row1, row2] : blocks)
+        {
+            relative_listener rl = mp_impl->make_relative_listener(key, row1, row2);
+            abs_range_t dest = rl.dest.to_abs(rl.src.first);
+
+            std::string dest_name = rl.dest.first == rl.dest.last ?
+                resolver->get_name(rl.dest.first, rl.src.first, false) :
+                resolver->get_name(rl.dest, rl.src.first, false);
+
+            std::ostringstream os;
+            os << mp_impl->print(rl.src);
+            os << " -> Sheet" << (dest.first.sheet+1) << '!' << dest_name << " (relative)";
+            lines.push_back(os.str());
+        }
+    }
+
     if (lines.empty())
         return std::string();
 
@@ -402,15 +1429,96 @@ std::string dirty_cell_tracker::to_string() const
     return os.str();
 }
 
+void dirty_cell_tracker::compact()
+{
+    for (rtree_type& tree : mp_impl->m_grids)
+        rebuild_tree(tree);
+
+    for (relative_rtree_type& tree : mp_impl->m_relative_grids)
+        rebuild_tree(tree);
+
+    mp_impl->m_erased_counts.clear();
+    mp_impl->m_relative_erased_counts.clear();
+}
+
+std::vector<dirty_cell_tracker::sheet_memory_usage> dirty_cell_tracker::get_memory_usage() const
+{
+    std::vector<sheet_memory_usage> ret;
+
+    auto fetch_usage = [&ret](size_t sheet) -> sheet_memory_usage&
+    {
+        while (ret.size() <= sheet)
+        {
+            ret.emplace_back();
+            ret.back().sheet = ret.size() - 1;
+        }
+
+        return ret[sheet];
+    };
+
+    for (size_t i = 0; i < mp_impl->m_grids.size(); ++i)
+    {
+        sheet_memory_usage& usage = fetch_usage(i);
+        usage.bytes += sizeof(rtree_type);
+        add_tree_usage(mp_impl->m_grids[i], usage);
+    }
+
+    for (size_t i = 0; i < mp_impl->m_relative_grids.size(); ++i)
+    {
+        sheet_memory_usage& usage = fetch_usage(i);
+        usage.bytes += sizeof(relative_rtree_type);
+        add_tree_usage(mp_impl->m_relative_grids[i], usage);
+    }
+
+    for (size_t i = 0; i < mp_impl->m_column_listeners.size(); ++i)
+    {
+        sheet_memory_usage& usage = fetch_usage(i);
+        mp_impl->m_column_listeners[i].add_usage(usage.listeners, usage.bytes);
+    }
+
+    for (size_t i = 0; i < mp_impl->m_row_listeners.size(); ++i)
+    {
+        sheet_memory_usage& usage = fetch_usage(i);
+        mp_impl->m_row_listeners[i].add_usage(usage.listeners, usage.bytes);
+    }
+
+    // The blocks of the relative listeners, which are counted as listeners
+    // in their R-trees already.
+    constexpr size_t key_node_size = sizeof(relative_blocks_type::value_type) + 2 * sizeof(void*);
+    constexpr size_t block_node_size = sizeof(std::pair<const rc_t, rc_t>) + 4 * sizeof(void*);
+
+    for (const auto& [key, blocks] : mp_impl->m_relative_blocks)
+    {
+        sheet_memory_usage& usage = fetch_usage(key.sheet);
+        usage.bytes += key_node_size + blocks.size() * block_node_size;
+    }
+
+    return ret;
+}
+
 bool dirty_cell_tracker::empty() const
 {
+    mp_impl->check_not_bulk_mode("empty");
+
     for (const rtree_type& grid : mp_impl->m_grids)
     {
         if (!grid.empty())
             return false;
     }
 
-    return true;
+    for (const interval_listeners& listeners : mp_impl->m_column_listeners)
+    {
+        if (!listeners.empty())
+            return false;
+    }
+
+    for (const interval_listeners& listeners : mp_impl->m_row_listeners)
+    {
+        if (!listeners.empty())
+            return false;
+    }
+
+    return mp_impl->m_relative_blocks.empty();
 }
 
 }
@@ -9,6 +9,7 @@
 #include <cassert>
 #include <iostream>
 #include <unordered_map>
+#include <stdexcept>
 
 using namespace ixion;
 using namespace std;
@@ -376,6 +377,278 @@ void test_listen_to_3d_range()
     assert(tracker.empty());
 }
 
+void test_query_direct_dependents()
+{
+    cout << "--" << endl << __FUNCTION__ << endl;
+
+    dirty_cell_tracker tracker;
+
+    abs_address_t A1(0, 0, 0);
+    abs_address_t A2(0, 1, 0);
+    abs_address_t A3(0, 2, 0);
+    abs_range_t B1_B3(0, 0, 1, 3, 1);
+
+    // A2 and A3 listen to A1, and B1:B3 (grouped) listens to A2.
+    tracker.add(A2, A1);
+    tracker.add(A3, A1);
+    tracker.add(B1_B3, A2);
+
+    abs_range_set_t res = tracker.query_direct_dependents(A1);
+    assert(res.size() == 2);
+    assert(res.count(A2) == 1);
+    assert(res.count(A3) == 1);
+
+    // Indirect dependents should not be included.
+    res = tracker.query_direct_dependents(A2);
+    assert(res.size() == 1);
+    assert(*res.begin() == B1_B3);
+
+    res = tracker.query_direct_dependents(A3);
+    assert(res.empty());
+
+    // Query by range.
+    abs_range_t A1_A2(0, 0, 0, 2, 1);
+    res = tracker.query_direct_dependents(A1_A2);
+    assert(res.size() == 3);
+}
+
+void test_query_many_modified_cells()
+{
+    cout << "--" << endl << __FUNCTION__ << endl;
+
+    dirty_cell_tracker tracker;
+
+    abs_address_t C1(0, 0, 2), C2(0, 1, 2), D1(0, 0, 3), E1(0, 0, 4), F1(0, 0, 5);
+
+    tracker.add(C1, abs_address_t(0, 0, 0)); // C1 listens to A1.
+    tracker.add(C2, abs_address_t(0, 4, 1)); // C2 listens to B5.
+    tracker.add(D1, abs_range_t(0, 2, 0, 1, 2)); // D1 listens to A3:B3.
+    tracker.add(E1, abs_address_t(0, 99, 25)); // E1 listens to Z100.
+    tracker.add(F1, C1); // F1 listens to C1.
+
+    // Modify A1:B4 one cell at a time, as well as A10 on its own.  The
+    // modified cells are merged before being looked up, which must not
+    // change the outcome.
+    abs_range_set_t mod_cells;
+    for (row_t row = 0; row < 4; ++row)
+    {
+        for (col_t col = 0; col < 2; ++col)
+            mod_cells.emplace(0, row, col);
+    }
+    mod_cells.emplace(0, 9, 0);
+
+    abs_range_set_t res = tracker.query_dirty_cells(mod_cells);
+    assert(res.size() == 3);
+    assert(res.count(C1) == 1);
+    assert(res.count(D1) == 1);
+    assert(res.count(F1) == 1);
+
+    std::vector<abs_range_t> sorted = tracker.query_and_sort_dirty_cells(mod_cells);
+    assert(sorted.size() == 3);
+    ranks_type ranks = create_ranks(sorted);
+    assert(ranks[C1] < ranks[F1]);
+}
+
+void test_bulk_add()
+{
+    cout << "--" << endl << __FUNCTION__ << endl;
+
+    dirty_cell_tracker tracker;
+
+    abs_address_t A1(0, 0, 0), A2(0, 1, 0), B1(0, 0, 1), B2(0, 1, 1), C1(0, 0, 2);
+    abs_range_t A1_A2(0, 0, 0, 2, 1);
+
+    // Add one listener the regular way, before the bulk load.
+    tracker.add(C1, A1);
+
+    tracker.begin_bulk_add();
+    tracker.add(B1, A1);
+    tracker.add(B2, A1_A2);
+    tracker.add(C1, A1_A2);
+    tracker.add(abs_address_t(1, 0, 0), A2); // Sheet2!A1 listens to A2.
+
+    // Queries and removals are not allowed until the bulk load ends.
+    try
+    {
+        tracker.query_direct_dependents(A1);
+        assert(!"logic_error was not thrown");
+    }
+    catch (const std::logic_error&)
+    {
+    }
+
+    try
+    {
+        tracker.remove(C1, A1);
+        assert(!"logic_error was not thrown");
+    }
+    catch (const std::logic_error&)
+    {
+    }
+
+    tracker.end_bulk_add();
+
+    abs_range_set_t res = tracker.query_direct_dependents(A1);
+    assert(res.size() == 3);
+    assert(res.count(B1) == 1);
+    assert(res.count(B2) == 1);
+    assert(res.count(C1) == 1);
+
+    res = tracker.query_direct_dependents(A2);
+    assert(res.size() == 3);
+    assert(res.count(B2) == 1);
+    assert(res.count(C1) == 1);
+    assert(res.count(abs_address_t(1, 0, 0)) == 1);
+
+    // The listeners added in bulk can be removed individually.
+    tracker.remove(B1, A1);
+    tracker.remove(B2, A1_A2);
+    tracker.remove(C1, A1_A2);
+    tracker.remove(C1, A1);
+    tracker.remove(abs_address_t(1, 0, 0), A2);
+    assert(tracker.empty());
+}
+
+void test_whole_column_listeners()
+{
+    cout << "--" << endl << __FUNCTION__ << endl;
+
+    dirty_cell_tracker tracker;
+
+    abs_address_t C1(0, 0, 2), D1(0, 0, 3), E1(0, 0, 4);
+
+    // C1 listens to A:A, D1 listens to 3:4, and E1 listens to C1.
+    abs_range_t col_A(0, 0, 0, 1, 1);
+    col_A.set_all_rows();
+    abs_range_t rows_3_4(0, 2, 0, 2, 1);
+    rows_3_4.set_all_columns();
+
+    tracker.add(C1, col_A);
+    tracker.add(D1, rows_3_4);
+    tracker.add(E1, C1);
+
+    abs_range_set_t res = tracker.query_direct_dependents(abs_address_t(0, 9999, 0));
+    assert(res.size() == 1);
+    assert(res.count(C1) == 1);
+
+    res = tracker.query_direct_dependents(abs_address_t(0, 3, 7));
+    assert(res.size() == 1);
+    assert(res.count(D1) == 1);
+
+    // A3 is referenced by both.
+    res = tracker.query_direct_dependents(abs_address_t(0, 2, 0));
+    assert(res.size() == 2);
+
+    res = tracker.query_direct_dependents(abs_address_t(0, 0, 1));
+    assert(res.empty());
+
+    abs_range_set_t mod_cells;
+    mod_cells.emplace(0, 500, 0);
+    res = tracker.query_dirty_cells(mod_cells);
+    assert(res.size() == 2);
+    assert(res.count(C1) == 1);
+    assert(res.count(E1) == 1);
+
+    tracker.remove(C1, col_A);
+    tracker.remove(D1, rows_3_4);
+    tracker.remove(E1, C1);
+    assert(tracker.empty());
+}
+
+void test_relative_listeners()
+{
+    cout << "--" << endl << __FUNCTION__ << endl;
+
+    dirty_cell_tracker tracker;
+
+    // B1:B1000 each reference the cell immediately to the left, as in a
+    // formula =A1*2 filled down.
+    address_t left(0, 0, -1, false, false, false);
+    range_t ref_left(left, left);
+    for (row_t row = 0; row < 1000; ++row)
+        tracker.add_relative(abs_address_t(0, row, 1), ref_left);
+
+    // C1:C10 each sum up the values from A1 down to the same row, as in a
+    // formula =SUM(A$1:A1) filled down.
+    range_t ref_total(address_t(0, 0, -2, false, true, false), address_t(0, 0, -2, false, false, false));
+    tracker.add_relative(abs_range_t(0, 0, 2, 10, 1), ref_total);
+
+    abs_range_set_t res = tracker.query_direct_dependents(abs_address_t(0, 499, 0));
+    assert(res.size() == 1);
+    assert(res.count(abs_address_t(0, 499, 1)) == 1);
+
+    res = tracker.query_direct_dependents(abs_address_t(0, 4, 0));
+    assert(res.size() == 7); // B5 and C5:C10
+    assert(res.count(abs_address_t(0, 4, 1)) == 1);
+    for (row_t row = 4; row < 10; ++row)
+        assert(res.count(abs_address_t(0, row, 2)) == 1);
+
+    res = tracker.query_direct_dependents(abs_range_t(0, 10, 0, 20, 1));
+    assert(res.size() == 20); // B11:B30
+
+    res = tracker.query_direct_dependents(abs_address_t(0, 0, 1));
+    assert(res.empty());
+
+    // Remove one cell from the middle of the column.
+    tracker.remove_relative(abs_address_t(0, 499, 1), ref_left);
+
+    res = tracker.query_direct_dependents(abs_range_t(0, 498, 0, 3, 1));
+    assert(res.size() == 2);
+    assert(res.count(abs_address_t(0, 498, 1)) == 1);
+    assert(res.count(abs_address_t(0, 500, 1)) == 1);
+
+    abs_range_set_t mod_cells;
+    mod_cells.emplace(0, 9, 0);
+    std::vector<abs_range_t> sorted = tracker.query_and_sort_dirty_cells(mod_cells);
+    assert(sorted.size() == 2); // B10 and C10
+
+    tracker.remove_relative(abs_range_t(0, 0, 1, 499, 1), ref_left);
+    tracker.remove_relative(abs_range_t(0, 500, 1, 500, 1), ref_left);
+    tracker.remove_relative(abs_range_t(0, 0, 2, 10, 1), ref_total);
+    assert(tracker.empty());
+}
+
+void test_compact()
+{
+    cout << "--" << endl << __FUNCTION__ << endl;
+
+    dirty_cell_tracker tracker;
+
+    // C1:C3000 each listen to the cell in column A on the same row.
+    for (row_t row = 0; row < 3000; ++row)
+        tracker.add(abs_address_t(0, row, 2), abs_address_t(0, row, 0));
+
+    std::vector<dirty_cell_tracker::sheet_memory_usage> usage = tracker.get_memory_usage();
+    assert(usage.size() == 1);
+    assert(usage[0].tree_entries == 3000);
+    assert(usage[0].listeners == 3000);
+    assert(usage[0].tree_nodes > 0);
+    size_t bytes = usage[0].bytes;
+
+    // Removing most of them causes the tree to get rebuilt along the way.
+    for (row_t row = 0; row < 2000; ++row)
+        tracker.remove(abs_address_t(0, row, 2), abs_address_t(0, row, 0));
+
+    usage = tracker.get_memory_usage();
+    assert(usage[0].tree_entries == 1000);
+    assert(usage[0].listeners == 1000);
+    assert(usage[0].bytes < bytes);
+
+    abs_range_set_t res = tracker.query_direct_dependents(abs_range_t(0, 1990, 0, 20, 1));
+    assert(res.size() == 10);
+
+    tracker.compact();
+
+    res = tracker.query_direct_dependents(abs_range_t(0, 1990, 0, 20, 1));
+    assert(res.size() == 10);
+    assert(res.count(abs_address_t(0, 2000, 2)) == 1);
+
+    for (row_t row = 2000; row < 3000; ++row)
+        tracker.remove(abs_address_t(0, row, 2), abs_address_t(0, row, 0));
+
+    assert(tracker.empty());
+}
+
 int main()
 {
     test_empty_query();
@@ -387,6 +660,12 @@ int main()
     test_recursive_tracking();
     test_listen_to_cell_in_range();
     test_listen_to_3d_range();
+    test_query_direct_dependents();
+    test_query_many_modified_cells();
+    test_bulk_add();
+    test_whole_column_listeners();
+    test_relative_listeners();
+    test_compact();
 
     return EXIT_SUCCESS;
 }
@@ -11,9 +11,16 @@
 #include "ixion/formula_name_resolver.hpp"
 #include "ixion/formula.hpp"
 #include "ixion/cell_access.hpp"
+#include "ixion/cell.hpp"
+#include "ixion/dirty_cell_tracker.hpp"
+#include "ixion/formula_tokens.hpp"
 
+#include <algorithm>
 #include <cstring>
 #include <sstream>
+#include <map>
+#include <unordered_map>
+#include <vector>
 
 namespace ixion {
 
@@ -46,6 +53,56 @@ abs_address_t to_address(
     throw std::logic_error("unrecognized cell position type.");
 }
 
+/**
+ * Get all the cell ranges that a formula cell references, in the same way
+ * register_formula_cell() registers them with the cell tracker.
+ */
+std::vector<abs_range_t> get_ref_ranges(
+    const model_context& cxt, const abs_address_t& pos, const formula_cell& cell)
+{
+    std::vector<abs_range_t> ranges;
+
+    for (const formula_token* p : cell.get_ref_tokens(cxt, pos))
+    {
+        switch (p->get_opcode())
+        {
+            case fop_single_ref:
+                ranges.emplace_back(p->get_single_ref().to_abs(pos));
+                break;
+            case fop_range_ref:
+            {
+                abs_range_t range = p->get_range_ref().to_abs(pos);
+                rc_size_t sheet_size = cxt.get_sheet_size();
+                if (range.all_columns())
+                {
+                    range.first.column = 0;
+                    range.last.column = sheet_size.column - 1;
+                }
+                if (range.all_rows())
+                {
+                    range.first.row = 0;
+                    range.last.row = sheet_size.row - 1;
+                }
+                range.reorder();
+                ranges.push_back(range);
+                break;
+            }
+            default:
+                ;
+        }
+    }
+
+    return ranges;
+}
+
+/**
+ * Maximum number of cells an incremental level update may visit.  Beyond
+ * this, recomputing the levels of all formula cells at once is cheaper, as
+ * is the case when inserting many formula cells that depend on one
+ * another.
+ */
+constexpr size_t level_update_budget = 1024;
+
 } // anonymous namespace
 
 document::cell_pos::cell_pos(const char* p) :
@@ -80,6 +137,33 @@ struct document::impl
     abs_range_set_t modified_cells;
     abs_range_set_t modified_formula_cells;
 
+    /**
+     * Level of each formula cell in the dependency graph.  The level of a
+     * formula cell is always greater than the levels of all formula cells
+     * it references, therefore calculating the dirty formula cells in
+     * ascending order of their levels respects their dependencies.  The
+     * levels are kept up-to-date as the formula cells get inserted, so
+     * that no topological sort is needed on recalculation.  Every formula
+     * cell inserted via this document has an entry, even while the levels
+     * are stale.
+     */
+    std::unordered_map<abs_range_t, size_t, abs_range_t::hash> levels;
+
+    /**
+     * Set to true when updating the levels on insertion would take too much
+     * work, or when a circular dependency may have been broken.  The levels
+     * of all formula cells then get recomputed at the next recalculation.
+     */
+    bool levels_stale = false;
+
+    /**
+     * Set to true when a circular dependency exists among the formula
+     * cells, in which case the levels are not meaningful.  Recalculations
+     * then fall back to sorting all the dirty formula cells, until the
+     * removal of a formula cell breaks the cycle.
+     */
+    bool circular = false;
+
     impl() :
         cxt(),
         resolver(formula_name_resolver::get(formula_name_resolver_t::excel_a1, &cxt))
@@ -104,7 +188,7 @@ struct document::impl
     void set_numeric_cell(cell_pos pos, double val)
     {
         abs_address_t addr = to_address(cxt, *resolver, pos);
-        unregister_formula_cell(cxt, addr);
+        remove_formula_cell(addr);
         cxt.set_numeric_cell(addr, val);
         modified_cells.insert(addr);
     }
@@ -112,7 +196,7 @@ struct document::impl
     void set_string_cell(cell_pos pos, std::string_view s)
     {
         abs_address_t addr = to_address(cxt, *resolver, pos);
-        unregister_formula_cell(cxt, addr);
+        remove_formula_cell(addr);
         cxt.set_string_cell(addr, s);
         modified_cells.insert(addr);
     }
@@ -120,7 +204,7 @@ struct document::impl
     void set_boolean_cell(cell_pos pos, bool val)
     {
         abs_address_t addr = to_address(cxt, *resolver, pos);
-        unregister_formula_cell(cxt, addr);
+        remove_formula_cell(addr);
         cxt.set_boolean_cell(addr, val);
         modified_cells.insert(addr);
     }
@@ -128,7 +212,7 @@ struct document::impl
     void empty_cell(cell_pos pos)
     {
         abs_address_t addr = to_address(cxt, *resolver, pos);
-        unregister_formula_cell(cxt, addr);
+        remove_formula_cell(addr);
         cxt.empty_cell(addr);
         modified_cells.insert(addr);
     }
@@ -148,17 +232,267 @@ struct document::impl
     void set_formula_cell(cell_pos pos, std::string_view formula)
     {
         abs_address_t addr = to_address(cxt, *resolver, pos);
-        unregister_formula_cell(cxt, addr);
+        remove_formula_cell(addr);
         auto tokens = parse_formula_string(cxt, addr, *resolver, formula);
         formula_cell* fc = cxt.set_formula_cell(addr, std::move(tokens));
         register_formula_cell(cxt, addr, fc);
         modified_formula_cells.insert(addr);
+
+        levels[addr] = 0;
+        if (!levels_stale && !circular && !update_levels(addr, *fc))
+            levels_stale = true;
+    }
+
+    void remove_formula_cell(const abs_address_t& addr)
+    {
+        if (!cxt.get_formula_cell(addr))
+            return;
+
+        // Removing a formula cell only removes dependencies, which never
+        // invalidates the levels of the remaining formula cells.  It may
+        // break a circular dependency, however.
+        unregister_formula_cell(cxt, addr);
+        levels.erase(addr);
+
+        if (circular)
+            levels_stale = true;
+    }
+
+    /**
+     * Assign a level to a newly inserted formula cell, and raise the levels
+     * of the formula cells that depend on it directly or indirectly where
+     * necessary.
+     *
+     * @return true if the levels have been updated, or false if the update
+     *         has been abandoned because it would take too much work, in
+     *         which case the levels are left inconsistent.
+     */
+    bool update_levels(const abs_address_t& addr, const formula_cell& fc)
+    {
+        size_t budget = level_update_budget;
+
+        // The level must be greater than those of all the formula cells it
+        // references.
+        size_t level = 0;
+        sheet_t sheet = 0;
+
+        column_block_callback_t cb = [&](col_t col, row_t row1, row_t row2, const column_block_shape_t& node)
+        {
+            if (node.type != column_block_t::formula)
+                return true;
+
+            size_t n = row2 - row1 + 1;
+            if (n > budget)
+            {
+                budget = 0;
+                return false;
+            }
+
+            budget -= n;
+
+            for (row_t row = row1; row <= row2; ++row)
+            {
+                auto it = levels.find(abs_address_t(sheet, row, col));
+                if (it != levels.end())
+                    level = std::max(level, it->second + 1);
+            }
+
+            return true;
+        };
+
+        for (const abs_range_t& range : get_ref_ranges(cxt, addr, fc))
+        {
+            for (sheet = range.first.sheet; sheet <= range.last.sheet; ++sheet)
+            {
+                cxt.walk(sheet, range, cb);
+                if (!budget)
+                    return false;
+            }
+        }
+
+        levels[addr] = level;
+
+        // Raise the levels of the existing dependents as needed.  Reaching
+        // the new cell again means it has introduced a circular dependency.
+        const dirty_cell_tracker& tracker = cxt.get_cell_tracker();
+        std::vector<abs_range_t> stack(1, addr);
+
+        while (!stack.empty())
+        {
+            abs_range_t cur = stack.back();
+            stack.pop_back();
+            size_t cur_level = levels[cur];
+
+            for (const abs_range_t& dep : tracker.query_direct_dependents(cur))
+            {
+                if (!budget--)
+                    return false;
+
+                auto it = levels.find(dep);
+                if (it == levels.end() || it->second > cur_level)
+                    continue;
+
+                if (dep == abs_range_t(addr))
+                {
+                    circular = true;
+                    return true;
+                }
+
+                it->second = cur_level + 1;
+                stack.push_back(dep);
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     * Recompute the levels of all formula cells at once, by sorting them
+     * topologically.  A formula cell that never gets sorted is part of, or
+     * depends on, a circular dependency.
+     */
+    void rebuild_levels()
+    {
+        const dirty_cell_tracker& tracker = cxt.get_cell_tracker();
+
+        // Number of precedents of each formula cell not yet sorted.
+        std::unordered_map<abs_range_t, size_t, abs_range_t::hash> counts;
+        std::unordered_map<abs_range_t, abs_range_set_t, abs_range_t::hash> dependents;
+
+        for (auto& [pos, level] : levels)
+        {
+            level = 0;
+            counts.emplace(pos, 0);
+        }
+
+        for (const auto& entry : levels)
+        {
+            abs_range_set_t& deps = dependents[entry.first];
+            deps = tracker.query_direct_dependents(entry.first);
+
+            for (auto it = deps.begin(); it != deps.end(); )
+            {
+                auto it_count = counts.find(*it);
+                if (it_count == counts.end())
+                {
+                    // Not a formula cell inserted via this document.
+                    it = deps.erase(it);
+                    continue;
+                }
+
+                ++it_count->second;
+                ++it;
+            }
+        }
+
+        std::vector<abs_range_t> ready;
+        for (const auto& [pos, count] : counts)
+        {
+            if (!count)
+                ready.push_back(pos);
+        }
+
+        size_t sorted = 0;
+
+        while (!ready.empty())
+        {
+            abs_range_t cur = ready.back();
+            ready.pop_back();
+            ++sorted;
+
+            size_t cur_level = levels[cur];
+
+            for (const abs_range_t& dep : dependents[cur])
+            {
+                size_t& level = levels[dep];
+                level = std::max(level, cur_level + 1);
+
+                if (!--counts[dep])
+                    ready.push_back(dep);
+            }
+        }
+
+        circular = sorted < levels.size();
+        levels_stale = false;
+    }
+
+    /**
+     * Recalculate the dirty formula cells one level at a time, starting with
+     * the formula cells that directly reference the modified cells.  The
+     * dependents of a formula cell become dirty only when its result has
+     * actually changed, so that the recalculation stops spreading as soon
+     * as the results stay the same.
+     */
+    void calculate_by_level(size_t thread_count)
+    {
+        const dirty_cell_tracker& tracker = cxt.get_cell_tracker();
+
+        std::map<size_t, std::vector<abs_range_t>> dirty_by_level;
+        abs_range_set_t queued;
+
+        auto push = [&](const abs_range_t& pos)
+        {
+            auto it = levels.find(pos);
+            if (it == levels.end())
+                // Not a formula cell inserted via this document.
+                return;
+
+            if (queued.insert(pos).second)
+                dirty_by_level[it->second].push_back(pos);
+        };
+
+        for (const abs_range_t& r : modified_cells)
+        {
+            for (const abs_range_t& dep : tracker.query_direct_dependents(r))
+                push(dep);
+        }
+
+        for (const abs_range_t& r : modified_formula_cells)
+            push(r);
+
+        // Volatile cells and their dependents are always dirty.
+        for (const abs_range_t& r : tracker.query_dirty_cells(abs_range_set_t()))
+            push(r);
+
+        while (!dirty_by_level.empty())
+        {
+            // The formula cells on the same level never depend on one
+            // another.
+            auto it = dirty_by_level.begin();
+            std::vector<abs_range_t> cells = std::move(it->second);
+            dirty_by_level.erase(it);
+
+            calculate_sorted_cells(cxt, cells, thread_count);
+
+            for (size_t i = 0; i < cells.size(); ++i)
+            {
+                queued.erase(cells[i]);
+
+                const formula_cell* fc = cxt.get_formula_cell(cells[i].first);
+                if (fc && !fc->has_result_changed())
+                    // The result is unchanged.  Its dependents stay clean.
+                    continue;
+
+                for (const abs_range_t& dep : tracker.query_direct_dependents(cells[i]))
+                    push(dep);
+            }
+        }
     }
 
     void calculate(size_t thread_count)
     {
-        auto sorted_cells = query_and_sort_dirty_cells(cxt, modified_cells, &modified_formula_cells);
-        calculate_sorted_cells(cxt, sorted_cells, thread_count);
+        if (levels_stale)
+            rebuild_levels();
+
+        if (circular)
+        {
+            auto sorted_cells = query_and_sort_dirty_cells(cxt, modified_cells, &modified_formula_cells);
+            calculate_sorted_cells(
+                cxt, sorted_cells, thread_count, modified_cells, &modified_formula_cells);
+        }
+        else
+            calculate_by_level(thread_count);
+
         modified_cells.clear();
         modified_formula_cells.clear();
     }
@@ -9,10 +9,13 @@
 #include "ixion/address.hpp"
 #include "ixion/macros.hpp"
 #include "ixion/cell_access.hpp"
+#include "ixion/cell.hpp"
+#include "ixion/formula_result.hpp"
 
 #include <iostream>
 #include <cassert>
 #include <sstream>
+#include <string>
 
 using namespace std;
 using namespace ixion;
@@ -131,12 +134,122 @@ void test_custom_cell_address_syntax()
     assert(v == 345.0);
 }
 
+void test_incremental_calc()
+{
+    document doc;
+    doc.append_sheet("test");
+
+    // Insert the dependent formula cell before its precedent.
+    doc.set_formula_cell("C1", "B1+A2");
+    doc.set_formula_cell("B1", "A1*2");
+    doc.set_numeric_cell("A1", 1.0);
+    doc.set_numeric_cell("A2", 10.0);
+    doc.calculate(0);
+
+    assert(doc.get_numeric_value("B1") == 2.0);
+    assert(doc.get_numeric_value("C1") == 12.0);
+
+    doc.set_numeric_cell("A1", 5.0);
+    doc.calculate(0);
+    assert(doc.get_numeric_value("B1") == 10.0);
+    assert(doc.get_numeric_value("C1") == 20.0);
+
+    doc.set_numeric_cell("A2", 0.0);
+    doc.calculate(0);
+    assert(doc.get_numeric_value("C1") == 10.0);
+
+    // B1 no longer changes with A1.
+    doc.set_numeric_cell("A2", 4.0);
+    doc.set_formula_cell("B1", "A1*0");
+    doc.calculate(0);
+    assert(doc.get_numeric_value("B1") == 0.0);
+    assert(doc.get_numeric_value("C1") == 4.0);
+
+    // Plant a bogus result in C1.  It stays only if C1 does not get
+    // recalculated, which is the case as long as B1 keeps its result.
+    cell_access ca = doc.get_cell_access("C1");
+    formula_cell* fc = const_cast<formula_cell*>(ca.get_formula_cell());
+    assert(fc);
+    fc->set_result_cache(formula_result(-1.0));
+
+    doc.set_numeric_cell("A1", 7.0);
+    doc.calculate(0);
+    assert(doc.get_numeric_value("B1") == 0.0);
+    assert(doc.get_numeric_value("C1") == -1.0);
+
+    // Modifying A2 recalculates C1.
+    doc.set_numeric_cell("A2", 6.0);
+    doc.calculate(0);
+    assert(doc.get_numeric_value("C1") == 6.0);
+
+    // Replace the formula cell in B1 with a value.
+    doc.set_numeric_cell("B1", 3.0);
+    doc.calculate(0);
+    assert(doc.get_numeric_value("C1") == 9.0);
+}
+
+void test_broken_circular_dependency()
+{
+    document doc;
+    doc.append_sheet("test");
+
+    doc.set_formula_cell("A1", "B1+1");
+    doc.set_formula_cell("B1", "A1+1");
+    doc.set_formula_cell("C1", "A1*2");
+    doc.calculate(0);
+
+    // Break the circular dependency.
+    doc.set_numeric_cell("B1", 3.0);
+    doc.calculate(0);
+    assert(doc.get_numeric_value("A1") == 4.0);
+    assert(doc.get_numeric_value("C1") == 8.0);
+
+    doc.set_numeric_cell("B1", 5.0);
+    doc.calculate(0);
+    assert(doc.get_numeric_value("A1") == 6.0);
+    assert(doc.get_numeric_value("C1") == 12.0);
+}
+
+void test_bulk_insertion()
+{
+    document doc;
+    doc.append_sheet("test");
+
+    const row_t n = 3000;
+
+    // A chain of formula cells, each inserted before its precedent.
+    for (row_t row = 0; row < n - 1; ++row)
+        doc.set_formula_cell(abs_address_t(0, row, 0), "A" + std::to_string(row + 2) + "+1");
+
+    doc.set_numeric_cell(abs_address_t(0, n - 1, 0), 0.0);
+
+    // Running totals of column A filled down, each referencing a growing
+    // range.
+    for (row_t row = 0; row < n; ++row)
+        doc.set_formula_cell(abs_address_t(0, row, 1), "SUM(A$1:A" + std::to_string(row + 1) + ")");
+
+    doc.calculate(0);
+
+    assert(doc.get_numeric_value(abs_address_t(0, 0, 0)) == n - 1);
+    assert(doc.get_numeric_value(abs_address_t(0, 1, 1)) == (n - 1) + (n - 2));
+    assert(doc.get_numeric_value(abs_address_t(0, n - 1, 1)) == double(n - 1) * n / 2);
+
+    doc.set_numeric_cell(abs_address_t(0, n - 1, 0), 1.0);
+    doc.calculate(0);
+
+    assert(doc.get_numeric_value(abs_address_t(0, 0, 0)) == n);
+    assert(doc.get_numeric_value(abs_address_t(0, n - 1, 1)) == double(n + 1) * n / 2);
+}
+
 int main()
 {
     test_basic_calc();
     test_string_io();
     test_boolean_io();
     test_custom_cell_address_syntax();
+    test_incremental_calc();
+    test_broken_circular_dependency();
+    test_bulk_insertion();
 
     return EXIT_SUCCESS;
 }
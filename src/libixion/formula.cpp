@@ -20,6 +20,7 @@
 
 #include <sstream>
 #include <algorithm>
+#include <utility>
 
 namespace ixion {
 
@@ -283,6 +284,20 @@ void check_sheet_or_throw(const char* func_name, sheet_t sheet, const iface::for
     throw ixion::formula_registration_error(os.str());
 }
 
+/**
+ * Check whether a reference points to a different row for each cell of a
+ * formula filled down a column.  Such references of non-grouped formula
+ * cells are tracked as relative listeners, so that a whole column of them
+ * is stored as one.
+ */
+bool is_row_relative(const range_t& range)
+{
+    if (range.all_rows())
+        return false;
+
+    return !range.first.abs_row || !range.last.abs_row;
+}
+
 }
 
 void register_formula_cell(
@@ -333,28 +348,30 @@ void register_formula_cell(
         {
             case fop_single_ref:
             {
-                abs_address_t addr = p->get_single_ref().to_abs(pos);
+                address_t ref = p->get_single_ref();
+                abs_address_t addr = ref.to_abs(pos);
                 check_sheet_or_throw("register_formula_cell", addr.sheet, cxt, pos, *cell);
-                tracker.add(src_pos, addr);
+
+                if (!fg_props.grouped && is_row_relative(range_t(ref, ref)))
+                    tracker.add_relative(pos, range_t(ref, ref));
+                else
+                    tracker.add(src_pos, addr);
                 break;
             }
             case fop_range_ref:
             {
-                abs_range_t range = p->get_range_ref().to_abs(pos);
+                // Ranges of whole columns or rows are tracked as they are.
+                range_t ref = p->get_range_ref();
+                abs_range_t range = ref.to_abs(pos);
                 check_sheet_or_throw("register_formula_cell", range.first.sheet, cxt, pos, *cell);
-                rc_size_t sheet_size = cxt.get_sheet_size();
-                if (range.all_columns())
-                {
-                    range.first.column = 0;
-                    range.last.column = sheet_size.column - 1;
-                }
-                if (range.all_rows())
+
+                if (!fg_props.grouped && is_row_relative(ref))
+                    tracker.add_relative(pos, ref);
+                else
                 {
-                    range.first.row = 0;
-                    range.last.row = sheet_size.row - 1;
+                    range.reorder();
+                    tracker.add(src_pos, range);
                 }
-                range.reorder();
-                tracker.add(src_pos, range);
                 break;
             }
             default:
@@ -364,7 +381,7 @@ void register_formula_cell(
 
     // Check if the cell is volatile.
     const formula_tokens_store_ptr_t& ts = cell->get_tokens();
-    if (ts && has_volatile(ts->get()))
+    if (ts && has_volatile(std::as_const(*ts).get()))
         tracker.add_volatile(pos);
 }
 
@@ -380,6 +397,15 @@ void unregister_formula_cell(iface::formula_model_access& cxt, const abs_address
     dirty_cell_tracker& tracker = cxt.get_cell_tracker();
     tracker.remove_volatile(pos);
 
+    // The source range must match the one used in register_formula_cell().
+    formula_group_t fg_props = fcell->get_group_properties();
+    abs_range_t src_pos = pos;
+    if (fg_props.grouped)
+    {
+        src_pos.last.column += fg_props.size.column - 1;
+        src_pos.last.row += fg_props.size.row - 1;
+    }
+
     // Go through all its existing references, and remove
     // itself as their listener.  This step is important
     // especially during partial re-calculation.
@@ -392,16 +418,29 @@ void unregister_formula_cell(iface::formula_model_access& cxt, const abs_address
         {
             case fop_single_ref:
             {
-                abs_address_t addr = p->get_single_ref().to_abs(pos);
+                address_t ref = p->get_single_ref();
+                abs_address_t addr = ref.to_abs(pos);
                 check_sheet_or_throw("unregister_formula_cell", addr.sheet, cxt, pos, *fcell);
-                tracker.remove(pos, addr);
+
+                if (!fg_props.grouped && is_row_relative(range_t(ref, ref)))
+                    tracker.remove_relative(pos, range_t(ref, ref));
+                else
+                    tracker.remove(src_pos, addr);
                 break;
             }
             case fop_range_ref:
             {
-                abs_range_t range = p->get_range_ref().to_abs(pos);
+                range_t ref = p->get_range_ref();
+                abs_range_t range = ref.to_abs(pos);
                 check_sheet_or_throw("unregister_formula_cell", range.first.sheet, cxt, pos, *fcell);
-                tracker.remove(pos, range);
+
+                if (!fg_props.grouped && is_row_relative(ref))
+                    tracker.remove_relative(pos, ref);
+                else
+                {
+                    range.reorder();
+                    tracker.remove(src_pos, range);
+                }
                 break;
             }
             default:
@@ -8,9 +8,11 @@
 #include "ixion/formula.hpp"
 #include "ixion/address.hpp"
 #include "ixion/cell.hpp"
+#include "ixion/dirty_cell_tracker.hpp"
 #include "ixion/formula_name_resolver.hpp"
 
 #include "queue_entry.hpp"
+#include "dependency_graph.hpp"
 #include "debug.hpp"
 
 #if IXION_THREADS
@@ -38,10 +40,18 @@ public:
     }
 };
 
-}
-
-void calculate_sorted_cells(
-    iface::formula_model_access& cxt, const std::vector<abs_range_t>& formula_cells, size_t thread_count)
+/**
+ * Calculate the formula cells in the order they occur in the sequence.
+ *
+ * @param dirty (optional) flags indicating which formula cells must be
+ *              interpreted.  A cell not flagged gets interpreted only when
+ *              one of its precedents changes its result, else its previous
+ *              result gets restored.  When not given, all cells get
+ *              interpreted.
+ */
+void calculate_cells(
+    iface::formula_model_access& cxt, const std::vector<abs_range_t>& formula_cells, size_t thread_count,
+    std::vector<bool>* dirty)
 {
 #if IXION_THREADS == 0
     thread_count = 0;  // threads are disabled thus not to be used.
@@ -58,31 +68,122 @@ void calculate_sorted_cells(
     // Reset cell status.
     for (queue_entry& e : entries)
     {
-        e.p->reset();
+        e.p->reset(cxt, e.pos);
         IXION_TRACE("pos=" << e.pos.get_name() << " formula=" << detail::print_formula_expression(cxt, e.pos, *e.p));
     }
 
+    dependency_graph graph(cxt, formula_cells);
+
     // First, detect circular dependencies and mark those circular
     // dependent cells with appropriate error flags.
-    for (queue_entry& e : entries)
-        e.p->check_circular(cxt, e.pos);
+    std::vector<bool> circular = graph.find_circular_nodes();
+
+    std::vector<bool> has_precedents(entries.size(), false);
+    for (size_t i = 0, n = entries.size(); i < n; ++i)
+    {
+        for (size_t dep : graph.get_dependents(i))
+            has_precedents[dep] = true;
+    }
+
+    for (size_t i = 0, n = entries.size(); i < n; ++i)
+    {
+        if (!has_precedents[i])
+        {
+            // The graph knows no precedents of this cell, either because it
+            // has none, or because it has not been registered via
+            // register_formula_cell().  Check its references directly
+            // against the cells preceding it in the sequence.
+            if (!entries[i].p->check_circular(cxt, entries[i].pos))
+                circular[i] = true;
+
+            if (dirty)
+                (*dirty)[i] = true;
+        }
+        else
+            entries[i].p->set_circular_safe(!circular[i]);
+
+        if (!circular[i])
+            continue;
+
+        // Circular cells must get their error results, and so must the
+        // cells that depend on them.  Cells found by the direct check above
+        // are not known to the graph search.
+        if (dirty)
+            (*dirty)[i] = true;
+
+        for (size_t dep : graph.get_dependents(i))
+            circular[dep] = true;
+    }
 
     if (!thread_count)
     {
         // Interpret cells using just a single thread.
-        for (queue_entry& e : entries)
+        for (size_t i = 0, n = entries.size(); i < n; ++i)
+        {
+            queue_entry& e = entries[i];
+
+            if (dirty && !(*dirty)[i] && e.p->restore_previous_result())
+            {
+                cxt.publish_formula_result(e.pos, *e.p);
+                continue;
+            }
+
             e.p->interpret(cxt, e.pos);
 
+            if (dirty && e.p->has_result_changed())
+            {
+                for (size_t dep : graph.get_dependents(i))
+                    (*dirty)[dep] = true;
+            }
+        }
+
         return;
     }
 
 #if IXION_THREADS
-    // Interpret cells in topological order using threads.
-    formula_cell_queue queue(cxt, std::move(entries), thread_count);
+    // Interpret cells using threads.  Each cell gets dispatched as soon as
+    // all of its precedents have been interpreted.
+    formula_cell_queue queue(cxt, std::move(entries), graph, thread_count, dirty);
     queue.run();
 #endif
 }
 
 }
 
+void calculate_sorted_cells(
+    iface::formula_model_access& cxt, const std::vector<abs_range_t>& formula_cells, size_t thread_count)
+{
+    calculate_cells(cxt, formula_cells, thread_count, nullptr);
+}
+
+void calculate_sorted_cells(
+    iface::formula_model_access& cxt, const std::vector<abs_range_t>& formula_cells, size_t thread_count,
+    const abs_range_set_t& modified_cells, const abs_range_set_t* dirty_formula_cells)
+{
+    const dirty_cell_tracker& tracker = cxt.get_cell_tracker();
+
+    // Formula cells that directly reference the modified cells are the
+    // starting points of the calculation.
+    abs_range_set_t forced_cells;
+    for (const abs_range_t& r : modified_cells)
+    {
+        abs_range_set_t deps = tracker.query_direct_dependents(r);
+        forced_cells.insert(deps.begin(), deps.end());
+    }
+
+    if (dirty_formula_cells)
+        forced_cells.insert(dirty_formula_cells->begin(), dirty_formula_cells->end());
+
+    std::vector<bool> dirty(formula_cells.size(), false);
+    for (size_t i = 0, n = formula_cells.size(); i < n; ++i)
+    {
+        const abs_range_t& r = formula_cells[i];
+        dirty[i] = forced_cells.count(r) > 0 || tracker.is_volatile(r);
+    }
+
+    calculate_cells(cxt, formula_cells, thread_count, &dirty);
+}
+
+}
+
 /* vim:set shiftwidth=4 softtabstop=4 expandtab: */
@@ -8,6 +8,7 @@
 #include "formula_functions.hpp"
 #include "debug.hpp"
 #include "mem_str_buf.hpp"
+#include "numeric_kernels.hpp"
 
 #include "ixion/formula_tokens.hpp"
 #include "ixion/matrix.hpp"
@@ -27,6 +28,7 @@
 #include <thread>
 #include <chrono>
 #include <cmath>
+#include <limits>
 
 #include <mdds/sorted_string_map.hpp>
 
@@ -379,18 +381,28 @@ const map_type& get()
 std::string_view unknown_func_name = "unknown";
 
 /**
- * Traverse all elements of a passed matrix to sum up their values.
+ * Check if all elements of a matrix can be used in a matrix multiplication.
+ * Empty elements are treated as numeric values of 0.
  */
-double sum_matrix_elements(const matrix& mx)
+bool is_numeric_or_empty(const matrix& mx)
 {
-    double sum = 0.0;
-    size_t rows = mx.row_size();
-    size_t cols = mx.col_size();
-    for (size_t row = 0; row < rows; ++row)
-        for (size_t col = 0; col < cols; ++col)
-            sum += mx.get_numeric(row, col);
-
-    return sum;
+    for (size_t row = 0; row < mx.row_size(); ++row)
+    {
+        for (size_t col = 0; col < mx.col_size(); ++col)
+        {
+            switch (mx.get(row, col).type)
+            {
+                case matrix::element_type::numeric:
+                case matrix::element_type::boolean:
+                case matrix::element_type::empty:
+                    break;
+                default:
+                    return false;
+            }
+        }
+    }
+
+    return true;
 }
 
 numeric_matrix multiply_matrices(const matrix& left, const matrix& right)
@@ -483,9 +495,15 @@ void formula_functions::interpret(formula_function_t oc, formula_value_stack& ar
         case formula_function_t::func_concatenate:
             fnc_concatenate(args);
             break;
+        case formula_function_t::func_count:
+            fnc_count(args);
+            break;
         case formula_function_t::func_counta:
             fnc_counta(args);
             break;
+        case formula_function_t::func_countblank:
+            fnc_countblank(args);
+            break;
         case formula_function_t::func_if:
             fnc_if(args);
             break;
@@ -539,14 +557,38 @@ void formula_functions::fnc_max(formula_value_stack& args) const
     if (args.empty())
         throw formula_functions::invalid_arg("MAX requires one or more arguments.");
 
-    double ret = args.pop_value();
-    while (!args.empty())
+    double ret = std::numeric_limits<double>::lowest();
+    bool found = false;
+
+    auto update = [&ret, &found](const double* p, size_t n)
     {
-        double v = args.pop_value();
+        if (!n)
+            return;
+
+        double v = max_value(p, n);
         if (v > ret)
             ret = v;
+
+        found = true;
+    };
+
+    while (!args.empty())
+    {
+        switch (args.get_type())
+        {
+            case stack_value_t::range_ref:
+                m_context.fold_numeric(args.pop_range_ref(), update);
+                break;
+            default:
+            {
+                double v = args.pop_value();
+                update(&v, 1);
+            }
+        }
     }
-    args.push_value(ret);
+
+    // MAX returns 0 when no numeric values are found.
+    args.push_value(found ? ret : 0.0);
 }
 
 void formula_functions::fnc_min(formula_value_stack& args) const
@@ -554,14 +596,38 @@ void formula_functions::fnc_min(formula_value_stack& args) const
     if (args.empty())
         throw formula_functions::invalid_arg("MIN requires one or more arguments.");
 
-    double ret = args.pop_value();
-    while (!args.empty())
+    double ret = std::numeric_limits<double>::max();
+    bool found = false;
+
+    auto update = [&ret, &found](const double* p, size_t n)
     {
-        double v = args.pop_value();
+        if (!n)
+            return;
+
+        double v = min_value(p, n);
         if (v < ret)
             ret = v;
+
+        found = true;
+    };
+
+    while (!args.empty())
+    {
+        switch (args.get_type())
+        {
+            case stack_value_t::range_ref:
+                m_context.fold_numeric(args.pop_range_ref(), update);
+                break;
+            default:
+            {
+                double v = args.pop_value();
+                update(&v, 1);
+            }
+        }
     }
-    args.push_value(ret);
+
+    // MIN returns 0 when no numeric values are found.
+    args.push_value(found ? ret : 0.0);
 }
 
 void formula_functions::fnc_sum(formula_value_stack& args) const
@@ -571,27 +637,72 @@ void formula_functions::fnc_sum(formula_value_stack& args) const
     if (args.empty())
         throw formula_functions::invalid_arg("SUM requires one or more arguments.");
 
-    double ret = 0;
+    sum_accumulator sum;
     while (!args.empty())
     {
         switch (args.get_type())
         {
             case stack_value_t::range_ref:
-                ret += sum_matrix_elements(args.pop_range_value());
+            {
+                m_context.fold_numeric(args.pop_range_ref(),
+                    [&sum](const double* p, size_t n)
+                    {
+                        sum.add(p, n);
+                    }
+                );
+            }
             break;
             case stack_value_t::single_ref:
             case stack_value_t::string:
             case stack_value_t::value:
             default:
-                ret += args.pop_value();
+                sum.add(args.pop_value());
         }
     }
 
+    double ret = sum.get();
     args.push_value(ret);
 
     IXION_TRACE("function: sum end (result=" << ret << ")");
 }
 
+void formula_functions::fnc_count(formula_value_stack& args) const
+{
+    if (args.empty())
+        throw formula_functions::invalid_arg("COUNT requires one or more arguments.");
+
+    double ret = 0;
+    while (!args.empty())
+    {
+        switch (args.get_type())
+        {
+            case stack_value_t::value:
+                args.pop_value();
+                ++ret;
+            break;
+            case stack_value_t::range_ref:
+            {
+                abs_range_t range = args.pop_range_ref();
+                ret += m_context.count_range(range, value_numeric);
+            }
+            break;
+            case stack_value_t::single_ref:
+            {
+                abs_address_t pos = args.pop_single_ref();
+                abs_range_t range;
+                range.first = range.last = pos;
+                ret += m_context.count_range(range, value_numeric);
+            }
+            break;
+            default:
+                // Not a number.  Discard it without converting it.
+                args.release_back();
+        }
+    }
+
+    args.push_value(ret);
+}
+
 void formula_functions::fnc_counta(formula_value_stack& args) const
 {
     if (args.empty())
@@ -610,7 +721,7 @@ void formula_functions::fnc_counta(formula_value_stack& args) const
             case stack_value_t::range_ref:
             {
                 abs_range_t range = args.pop_range_ref();
-                ret += m_context.count_range(range, value_numeric | value_boolean | value_string);
+                ret += m_context.count_range(range, value_numeric | value_boolean | value_string | value_error);
             }
             break;
             case stack_value_t::single_ref:
@@ -618,7 +729,7 @@ void formula_functions::fnc_counta(formula_value_stack& args) const
                 abs_address_t pos = args.pop_single_ref();
                 abs_range_t range;
                 range.first = range.last = pos;
-                ret += m_context.count_range(range, value_numeric | value_boolean | value_string);
+                ret += m_context.count_range(range, value_numeric | value_boolean | value_string | value_error);
             }
             break;
             default:
@@ -630,12 +741,34 @@ void formula_functions::fnc_counta(formula_value_stack& args) const
     args.push_value(ret);
 }
 
+void formula_functions::fnc_countblank(formula_value_stack& args) const
+{
+    if (args.size() != 1)
+        throw formula_functions::invalid_arg("COUNTBLANK requires exactly 1 argument.");
+
+    abs_range_t range;
+
+    switch (args.get_type())
+    {
+        case stack_value_t::single_ref:
+            range.first = range.last = args.pop_single_ref();
+            break;
+        case stack_value_t::range_ref:
+            range = args.pop_range_ref();
+            break;
+        default:
+            throw formula_functions::invalid_arg("COUNTBLANK only takes a reference argument.");
+    }
+
+    args.push_value(m_context.count_range(range, value_empty));
+}
+
 void formula_functions::fnc_average(formula_value_stack& args) const
 {
     if (args.empty())
         throw formula_functions::invalid_arg("AVERAGE requires one or more arguments.");
 
-    double ret = 0;
+    sum_accumulator sum;
     double count = 0.0;
     while (!args.empty())
     {
@@ -643,33 +776,25 @@ void formula_functions::fnc_average(formula_value_stack& args) const
         {
             case stack_value_t::range_ref:
             {
-                matrix mx = args.pop_range_value();
-                size_t rows = mx.row_size();
-                size_t cols = mx.col_size();
-
-                for (size_t r = 0; r < rows; ++r)
-                {
-                    for (size_t c = 0; c < cols; ++c)
+                m_context.fold_numeric(args.pop_range_ref(),
+                    [&sum, &count](const double* p, size_t n)
                     {
-                        if (!mx.is_numeric(r, c))
-                            continue;
-
-                        ret += mx.get_numeric(r, c);
-                        ++count;
+                        sum.add(p, n);
+                        count += n;
                     }
-                }
+                );
             }
             break;
             case stack_value_t::single_ref:
             case stack_value_t::string:
             case stack_value_t::value:
             default:
-                ret += args.pop_value();
+                sum.add(args.pop_value());
                 ++count;
         }
     }
 
-    args.push_value(ret/count);
+    args.push_value(sum.get()/count);
 }
 
 void formula_functions::fnc_mmult(formula_value_stack& args) const
@@ -716,7 +841,7 @@ void formula_functions::fnc_mmult(formula_value_stack& args) const
 
     mx[0].swap(mx[1]); // Make it so that 0 -> left and 1 -> right.
 
-    if (!mx[0].is_numeric() || !mx[1].is_numeric())
+    if (!is_numeric_or_empty(mx[0]) || !is_numeric_or_empty(mx[1]))
         throw formula_functions::invalid_arg(
             "MMULT requires two numeric ranges. At least one range is not numeric.");
 
@@ -754,9 +879,11 @@ void formula_functions::fnc_if(formula_value_stack& args) const
     else
         std::advance(pos, 2);
 
-    formula_value_stack ret(m_context);
-    ret.push_back(args.release(pos));
-    args.swap(ret);
+    // Keep the chosen value and discard the rest, without giving up the
+    // storage of the argument stack.
+    formula_value_stack::value_type ret = args.release(pos);
+    args.clear();
+    args.push_back(std::move(ret));
 }
 
 void formula_functions::fnc_len(formula_value_stack& args) const
@@ -827,8 +954,14 @@ void formula_functions::fnc_subtotal(formula_value_stack& args) const
         case 109:
         {
             // SUM
-            matrix mx = m_context.get_range_value(range);
-            args.push_value(sum_matrix_elements(mx));
+            sum_accumulator sum;
+            m_context.fold_numeric(range,
+                [&sum](const double* p, size_t n)
+                {
+                    sum.add(p, n);
+                }
+            );
+            args.push_value(sum.get());
             break;
         }
         default:
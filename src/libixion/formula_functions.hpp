@@ -55,7 +55,9 @@ private:
     void fnc_max(formula_value_stack& args) const;
     void fnc_min(formula_value_stack& args) const;
     void fnc_sum(formula_value_stack& args) const;
+    void fnc_count(formula_value_stack& args) const;
     void fnc_counta(formula_value_stack& args) const;
+    void fnc_countblank(formula_value_stack& args) const;
     void fnc_average(formula_value_stack& args) const;
     void fnc_mmult(formula_value_stack& args) const;
     void fnc_pi(formula_value_stack& args) const;
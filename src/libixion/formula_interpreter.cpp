@@ -24,6 +24,7 @@
 #include <iostream>
 #include <sstream>
 #include <cmath>
+#include <utility>
 
 using namespace std;
 
@@ -40,11 +41,27 @@ public:
 opcode_token paren_open = opcode_token(fop_open);
 opcode_token paren_close = opcode_token(fop_close);
 
+/**
+ * Interpreter instance owned by the current thread.
+ */
+struct thread_interpreter
+{
+    std::unique_ptr<formula_interpreter> interpreter;
+    const iface::formula_model_access* context = nullptr;
+    bool in_use = false;
+};
+
+thread_local thread_interpreter tl_interpreter;
+
 }
 
 formula_interpreter::formula_interpreter(const formula_cell* cell, iface::formula_model_access& cxt) :
     m_parent_cell(cell),
     m_context(cxt),
+    m_stack_depth(0),
+    m_has_named_expression(false),
+    mp_cached_program(nullptr),
+    m_program_reusable(false),
     m_error(formula_error_t::no_error)
 {
 }
@@ -53,11 +70,30 @@ formula_interpreter::~formula_interpreter()
 {
 }
 
+void formula_interpreter::set_cell(const formula_cell* cell)
+{
+    m_parent_cell = cell;
+}
+
 void formula_interpreter::set_origin(const abs_address_t& pos)
 {
     m_pos = pos;
 }
 
+void formula_interpreter::set_program(const formula_program* program)
+{
+    mp_cached_program = program;
+}
+
+std::unique_ptr<formula_program> formula_interpreter::release_program()
+{
+    if (!m_program_reusable)
+        return nullptr;
+
+    m_program_reusable = false;
+    return std::move(mp_program);
+}
+
 bool formula_interpreter::interpret()
 {
     mp_handler = m_context.create_session_handler();
@@ -66,27 +102,34 @@ bool formula_interpreter::interpret()
 
     try
     {
-        init_tokens();
-
-        if (m_tokens.empty())
-        {
-            IXION_DEBUG("interpreter has no tokens to interpret");
-            return false;
-        }
-
-        m_cur_token_itr = m_tokens.begin();
         m_error = formula_error_t::no_error;
         m_result.reset();
+        m_program_reusable = false;
 
-        expression();
+        const formula_program* program = mp_cached_program;
 
-        if (m_cur_token_itr != m_tokens.end())
+        if (!program || mp_handler)
         {
-            if (mp_handler)
-                mp_handler->set_invalid_expression("formula token interpretation ended prematurely.");
-            return false;
+            init_tokens();
+
+            if (m_tokens.empty())
+            {
+                IXION_DEBUG("interpreter has no tokens to interpret");
+                return false;
+            }
+
+            if (!compile())
+            {
+                if (mp_handler)
+                    mp_handler->set_invalid_expression("formula token interpretation ended prematurely.");
+                return false;
+            }
+
+            program = mp_program.get();
+            m_program_reusable = !m_has_named_expression;
         }
 
+        run(*program);
         pop_result();
 
         IXION_TRACE("interpretation successfully finished");
@@ -119,9 +162,10 @@ bool formula_interpreter::interpret()
     return false;
 }
 
-formula_result formula_interpreter::transfer_result()
+void formula_interpreter::transfer_result(formula_result& dest)
 {
-    return std::move(m_result);
+    // Swapping keeps the storage of both instances.
+    dest.swap(m_result);
 }
 
 formula_error_t formula_interpreter::get_error() const
@@ -129,18 +173,30 @@ formula_error_t formula_interpreter::get_error() const
     return m_error;
 }
 
-void formula_interpreter::init_tokens()
+void formula_interpreter::reset()
 {
-    clear_stacks();
+    for (size_t i = 0; i < m_stack_depth; ++i)
+        m_stacks[i].clear();
 
+    m_stack_depth = 0;
+    m_tokens.clear();
+    m_result.reset();
+    mp_handler.reset();
+    mp_cached_program = nullptr;
+    m_program_reusable = false;
+}
+
+void formula_interpreter::init_tokens()
+{
     name_set used_names;
     m_tokens.clear();
+    m_has_named_expression = false;
 
     const formula_tokens_store_ptr_t& ts = m_parent_cell->get_tokens();
     if (!ts)
         return;
 
-    const formula_tokens_t& src_tokens = ts->get();
+    const formula_tokens_t& src_tokens = std::as_const(*ts).get();
 
     for (const std::unique_ptr<formula_token>& p : src_tokens)
     {
@@ -152,6 +208,7 @@ void formula_interpreter::init_tokens()
 
             used_names.insert(p->get_name());
             expand_named_expression(expr, used_names);
+            m_has_named_expression = true;
         }
         else
             // Normal token.
@@ -521,6 +578,19 @@ void compare_string_to_value(
 
 }
 
+bool formula_interpreter::compile()
+{
+    if (!mp_program)
+        mp_program = std::make_unique<formula_program>();
+    else
+        mp_program->clear();
+
+    m_cur_token_itr = m_tokens.begin();
+    expression();
+
+    return m_cur_token_itr == m_end_token_pos;
+}
+
 void formula_interpreter::expression()
 {
     // <term> + <term> + <term> + ... + <term>
@@ -533,14 +603,9 @@ void formula_interpreter::expression()
         if (!valid_expression_op(oc))
             return;
 
-        double val1 = 0.0, val2 = 0.0;
-        string str1, str2;
-        bool is_val1 = true, is_val2 = true;
-
-        stack_value_t vt;
-        if (!pop_stack_value_or_string(m_context, get_stack(), vt, val1, str1))
-            throw formula_error(formula_error_t::general_error);
-        is_val1 = vt == stack_value_t::value;
+        // The left operand gets resolved before the right operand gets
+        // evaluated.
+        emit(program_op_t::to_scalar);
 
         if (mp_handler)
             mp_handler->push_token(oc);
@@ -548,35 +613,8 @@ void formula_interpreter::expression()
         next();
         term();
 
-        if (!pop_stack_value_or_string(m_context, get_stack(), vt, val2, str2))
-            throw formula_error(formula_error_t::general_error);
-        is_val2 = vt == stack_value_t::value;
-
-        if (is_val1)
-        {
-            if (is_val2)
-            {
-                // Both are numeric values.
-                compare_values(get_stack(), oc, val1, val2);
-            }
-            else
-            {
-                compare_value_to_string(get_stack(), oc, val1, str2);
-            }
-        }
-        else
-        {
-            if (is_val2)
-            {
-                // Value 1 is string while value 2 is numeric.
-                compare_string_to_value(get_stack(), oc, str1, val2);
-            }
-            else
-            {
-                // Both are strings.
-                compare_strings(get_stack(), oc, str1, str2);
-            }
-        }
+        emit(program_op_t::expression_op);
+        mp_program->code.back().oc = oc;
     }
 }
 
@@ -589,61 +627,37 @@ void formula_interpreter::term()
         return;
 
     fopcode_t oc = token().get_opcode();
+    program_op_t op;
+    program_op_t left_op = program_op_t::to_value;
+
     switch (oc)
     {
         case fop_multiply:
-        {
-            if (mp_handler)
-                mp_handler->push_token(oc);
-
-            next();
-            double val = get_stack().pop_value();
-            term();
-            get_stack().push_value(val*get_stack().pop_value());
-            return;
-        }
+            op = program_op_t::multiply;
+            break;
         case fop_exponent:
-        {
-            if (mp_handler)
-                mp_handler->push_token(oc);
-
-            next();
-            double base = get_stack().pop_value();
-            term();
-            double exp = get_stack().pop_value();
-            get_stack().push_value(std::pow(base, exp));
-            return;
-        }
+            op = program_op_t::exponent;
+            break;
         case fop_concat:
-        {
-            if (mp_handler)
-                mp_handler->push_token(oc);
-
-            next();
-            std::string s1 = get_stack().pop_string();
-            term();
-            std::string s2 = get_stack().pop_string();
-            std::string s = s1 + s2;
-            get_stack().push_string(std::move(s));
-            return;
-        }
+            op = program_op_t::concat;
+            left_op = program_op_t::to_string;
+            break;
         case fop_divide:
-        {
-            if (mp_handler)
-                mp_handler->push_token(oc);
-
-            next();
-            double val = get_stack().pop_value();
-            term();
-            double val2 = get_stack().pop_value();
-            if (val2 == 0.0)
-                throw formula_error(formula_error_t::division_by_zero);
-            get_stack().push_value(val/val2);
-            return;
-        }
+            op = program_op_t::divide;
+            break;
         default:
-            ;
+            return;
     }
+
+    if (mp_handler)
+        mp_handler->push_token(oc);
+
+    // The left operand gets converted before the right operand gets
+    // evaluated.
+    emit(left_op);
+    next();
+    term();
+    emit(op);
 }
 
 void formula_interpreter::factor()
@@ -691,10 +705,7 @@ void formula_interpreter::factor()
     }
 
     if (negative_sign)
-    {
-        double v = get_stack().pop_value();
-        get_stack().push_value(v * -1.0);
-    }
+        emit(program_op_t::negate);
 }
 
 bool formula_interpreter::sign()
@@ -745,75 +756,39 @@ void formula_interpreter::paren()
 void formula_interpreter::single_ref()
 {
     address_t addr = token().get_single_ref();
-    IXION_TRACE("ref=" << addr.get_name() << "; origin=" << m_pos.get_name());
 
     if (mp_handler)
         mp_handler->push_single_ref(addr, m_pos);
 
-    abs_address_t abs_addr = addr.to_abs(m_pos);
-    IXION_TRACE("ref=" << abs_addr.get_name() << " (converted to absolute)");
-
-    if (abs_addr == m_pos)
-    {
-        // self-referencing is not permitted.
-        throw formula_error(formula_error_t::ref_result_not_available);
-    }
-
-    get_stack().push_single_ref(abs_addr);
+    emit(program_op_t::single_ref);
+    mp_program->code.back().index = mp_program->single_refs.size();
+    mp_program->single_refs.push_back(addr);
     next();
 }
 
 void formula_interpreter::range_ref()
 {
     range_t range = token().get_range_ref();
-    IXION_TRACE("ref-start=" << range.first.get_name() << "; ref-end=" << range.last.get_name() << "; origin=" << m_pos.get_name());
 
     if (mp_handler)
         mp_handler->push_range_ref(range, m_pos);
 
-    abs_range_t abs_range = range.to_abs(m_pos);
-    abs_range.reorder();
-
-    IXION_TRACE("ref-start=" << abs_range.first.get_name() << "; ref-end=" << abs_range.last.get_name() << " (converted to absolute)");
-
-    // Check the reference range to make sure it doesn't include the parent cell.
-    if (abs_range.contains(m_pos))
-    {
-        // Referenced range contains the address of this cell.  Not good.
-        throw formula_error(formula_error_t::ref_result_not_available);
-    }
-
-    get_stack().push_range_ref(abs_range);
+    emit(program_op_t::range_ref);
+    mp_program->code.back().index = mp_program->range_refs.size();
+    mp_program->range_refs.push_back(range);
     next();
 }
 
 void formula_interpreter::table_ref()
 {
-    const iface::table_handler* table_hdl = m_context.get_table_handler();
-    if (!table_hdl)
-    {
-        IXION_DEBUG("failed to get a table_handler instance.");
-        throw formula_error(formula_error_t::ref_result_not_available);
-    }
-
     table_t table = token().get_table_ref();
 
     if (mp_handler)
         mp_handler->push_table_ref(table);
 
-    abs_range_t range(abs_range_t::invalid);
-    if (table.name != empty_string_id)
-    {
-        range = table_hdl->get_range(table.name, table.column_first, table.column_last, table.areas);
-    }
-    else
-    {
-        // Table name is not given.  Use the current cell position to infer
-        // which table to use.
-        range = table_hdl->get_range(m_pos, table.column_first, table.column_last, table.areas);
-    }
-
-    get_stack().push_range_ref(range);
+    emit(program_op_t::table_ref);
+    mp_program->code.back().index = mp_program->table_refs.size();
+    mp_program->table_refs.push_back(table);
     next();
 }
 
@@ -821,7 +796,8 @@ void formula_interpreter::constant()
 {
     double val = token().get_value();
     next();
-    get_stack().push_value(val);
+    emit(program_op_t::value);
+    mp_program->code.back().value = val;
     if (mp_handler)
         mp_handler->push_value(val);
 }
@@ -829,12 +805,9 @@ void formula_interpreter::constant()
 void formula_interpreter::literal()
 {
     string_id_t sid = token().get_uint32();
-    const std::string* p = m_context.get_string(sid);
-    if (!p)
-        throw general_error("no string found for the specified string ID.");
-
     next();
-    get_stack().push_string(*p);
+    emit(program_op_t::string);
+    mp_program->code.back().index = sid;
     if (mp_handler)
         mp_handler->push_string(sid);
 }
@@ -848,10 +821,7 @@ void formula_interpreter::function()
     if (mp_handler)
         mp_handler->push_function(func_oc);
 
-    push_stack();
-
-    IXION_TRACE("function='" << get_formula_function_name(func_oc) << "'");
-    assert(get_stack().empty());
+    emit(program_op_t::begin_function);
 
     if (next_token().get_opcode() != fop_open)
         throw invalid_expression("expecting a '(' after a function name.");
@@ -861,6 +831,7 @@ void formula_interpreter::function()
 
     fopcode_t oc = next_token().get_opcode();
     bool expect_sep = false;
+    size_t arg_count = 0;
     while (oc != fop_close)
     {
         if (expect_sep)
@@ -877,6 +848,7 @@ void formula_interpreter::function()
         {
             expression();
             expect_sep = true;
+            ++arg_count;
         }
         oc = token_or_throw().get_opcode();
     }
@@ -886,38 +858,293 @@ void formula_interpreter::function()
 
     next();
 
-    // Function call pops all stack values pushed onto the stack this far, and
-    // pushes the result onto the stack.
-    formula_functions(m_context).interpret(func_oc, get_stack());
-    assert(get_stack().size() == 1);
+    emit(program_op_t::function);
+    program_instruction& ins = mp_program->code.back();
+    ins.func.oc = func_oc;
+    ins.func.arg_count = arg_count;
+}
 
-    pop_stack();
+void formula_interpreter::emit(program_op_t op)
+{
+    mp_program->code.emplace_back(op);
+}
+
+void formula_interpreter::run(const formula_program& program)
+{
+    clear_stacks();
+
+    for (const program_instruction& ins : program.code)
+    {
+        switch (ins.op)
+        {
+            case program_op_t::value:
+                get_stack().push_value(ins.value);
+                break;
+            case program_op_t::string:
+            {
+                const std::string* p = m_context.get_string(ins.index);
+                if (!p)
+                    throw general_error("no string found for the specified string ID.");
+
+                get_stack().push_string(*p);
+                break;
+            }
+            case program_op_t::single_ref:
+            {
+                const address_t& addr = program.single_refs[ins.index];
+                abs_address_t abs_addr = addr.to_abs(m_pos);
+                IXION_TRACE("ref=" << abs_addr.get_name() << " (converted to absolute)");
+
+                if (abs_addr == m_pos)
+                {
+                    // self-referencing is not permitted.
+                    throw formula_error(formula_error_t::ref_result_not_available);
+                }
+
+                get_stack().push_single_ref(abs_addr);
+                break;
+            }
+            case program_op_t::range_ref:
+            {
+                const range_t& range = program.range_refs[ins.index];
+                abs_range_t abs_range = range.to_abs(m_pos);
+                abs_range.reorder();
+
+                IXION_TRACE("ref-start=" << abs_range.first.get_name() << "; ref-end=" << abs_range.last.get_name() << " (converted to absolute)");
+
+                // Check the reference range to make sure it doesn't include the parent cell.
+                if (abs_range.contains(m_pos))
+                {
+                    // Referenced range contains the address of this cell.  Not good.
+                    throw formula_error(formula_error_t::ref_result_not_available);
+                }
+
+                get_stack().push_range_ref(abs_range);
+                break;
+            }
+            case program_op_t::table_ref:
+            {
+                const iface::table_handler* table_hdl = m_context.get_table_handler();
+                if (!table_hdl)
+                {
+                    IXION_DEBUG("failed to get a table_handler instance.");
+                    throw formula_error(formula_error_t::ref_result_not_available);
+                }
+
+                const table_t& table = program.table_refs[ins.index];
+
+                abs_range_t range(abs_range_t::invalid);
+                if (table.name != empty_string_id)
+                {
+                    range = table_hdl->get_range(table.name, table.column_first, table.column_last, table.areas);
+                }
+                else
+                {
+                    // Table name is not given.  Use the current cell position to infer
+                    // which table to use.
+                    range = table_hdl->get_range(m_pos, table.column_first, table.column_last, table.areas);
+                }
+
+                get_stack().push_range_ref(range);
+                break;
+            }
+            case program_op_t::to_value:
+            {
+                double val = get_stack().pop_value();
+                get_stack().push_value(val);
+                break;
+            }
+            case program_op_t::to_string:
+            {
+                std::string str = get_stack().pop_string();
+                get_stack().push_string(std::move(str));
+                break;
+            }
+            case program_op_t::to_scalar:
+            {
+                double val = 0.0;
+                string str;
+                stack_value_t vt;
+                if (!pop_stack_value_or_string(m_context, get_stack(), vt, val, str))
+                    throw formula_error(formula_error_t::general_error);
+
+                if (vt == stack_value_t::value)
+                    get_stack().push_value(val);
+                else
+                    get_stack().push_string(std::move(str));
+                break;
+            }
+            case program_op_t::negate:
+            {
+                double v = get_stack().pop_value();
+                get_stack().push_value(v * -1.0);
+                break;
+            }
+            case program_op_t::expression_op:
+            {
+                double val1 = 0.0, val2 = 0.0;
+                string str1, str2;
+                bool is_val1 = true, is_val2 = true;
+
+                stack_value_t vt;
+                if (!pop_stack_value_or_string(m_context, get_stack(), vt, val2, str2))
+                    throw formula_error(formula_error_t::general_error);
+                is_val2 = vt == stack_value_t::value;
+
+                if (!pop_stack_value_or_string(m_context, get_stack(), vt, val1, str1))
+                    throw formula_error(formula_error_t::general_error);
+                is_val1 = vt == stack_value_t::value;
+
+                if (is_val1)
+                {
+                    if (is_val2)
+                    {
+                        // Both are numeric values.
+                        compare_values(get_stack(), ins.oc, val1, val2);
+                    }
+                    else
+                    {
+                        compare_value_to_string(get_stack(), ins.oc, val1, str2);
+                    }
+                }
+                else
+                {
+                    if (is_val2)
+                    {
+                        // Value 1 is string while value 2 is numeric.
+                        compare_string_to_value(get_stack(), ins.oc, str1, val2);
+                    }
+                    else
+                    {
+                        // Both are strings.
+                        compare_strings(get_stack(), ins.oc, str1, str2);
+                    }
+                }
+                break;
+            }
+            case program_op_t::multiply:
+            {
+                double val2 = get_stack().pop_value();
+                double val = get_stack().pop_value();
+                get_stack().push_value(val*val2);
+                break;
+            }
+            case program_op_t::exponent:
+            {
+                double exp = get_stack().pop_value();
+                double base = get_stack().pop_value();
+                get_stack().push_value(std::pow(base, exp));
+                break;
+            }
+            case program_op_t::concat:
+            {
+                std::string s2 = get_stack().pop_string();
+                std::string s1 = get_stack().pop_string();
+                get_stack().push_string(s1 + s2);
+                break;
+            }
+            case program_op_t::divide:
+            {
+                double val2 = get_stack().pop_value();
+                double val = get_stack().pop_value();
+                if (val2 == 0.0)
+                    throw formula_error(formula_error_t::division_by_zero);
+                get_stack().push_value(val/val2);
+                break;
+            }
+            case program_op_t::begin_function:
+                push_stack();
+                break;
+            case program_op_t::function:
+            {
+                IXION_TRACE("function='" << get_formula_function_name(ins.func.oc) << "'");
+                assert(get_stack().size() == ins.func.arg_count);
+
+                // Function call pops all stack values pushed onto the stack this far, and
+                // pushes the result onto the stack.
+                formula_functions(m_context).interpret(ins.func.oc, get_stack());
+                assert(get_stack().size() == 1);
+
+                pop_stack();
+                break;
+            }
+        }
+    }
 }
 
 void formula_interpreter::clear_stacks()
 {
-    m_stacks.clear();
-    m_stacks.emplace_back(m_context);
+    for (size_t i = 0; i < m_stack_depth; ++i)
+        m_stacks[i].clear();
+
+    m_stack_depth = 0;
+    push_stack();
 }
 
 void formula_interpreter::push_stack()
 {
-    m_stacks.emplace_back(m_context);
+    if (m_stack_depth == m_stacks.size())
+        m_stacks.emplace_back(m_context);
+
+    ++m_stack_depth;
 }
 
 void formula_interpreter::pop_stack()
 {
-    assert(m_stacks.size() >= 2);
-    assert(m_stacks.back().size() == 1);
-    auto tmp = m_stacks.back().release_back();
-    m_stacks.pop_back();
-    m_stacks.back().push_back(std::move(tmp));
+    assert(m_stack_depth >= 2);
+    formula_value_stack& top = get_stack();
+    assert(top.size() == 1);
+    auto tmp = top.release_back();
+    top.clear();
+    --m_stack_depth;
+    get_stack().push_back(std::move(tmp));
 }
 
 formula_value_stack& formula_interpreter::get_stack()
 {
-    assert(!m_stacks.empty());
-    return m_stacks.back();
+    assert(m_stack_depth > 0);
+    return m_stacks[m_stack_depth-1];
+}
+
+formula_interpreter_lease::formula_interpreter_lease(
+    const formula_cell* cell, iface::formula_model_access& cxt) :
+    mp_interpreter(nullptr), m_borrowed(false)
+{
+    thread_interpreter& ti = tl_interpreter;
+
+    if (ti.in_use)
+    {
+        // The instance of this thread is already lent.
+        mp_own = std::make_unique<formula_interpreter>(cell, cxt);
+        mp_interpreter = mp_own.get();
+        return;
+    }
+
+    if (!ti.interpreter || ti.context != &cxt)
+    {
+        // An interpreter instance is bound to one model context.
+        ti.interpreter = std::make_unique<formula_interpreter>(cell, cxt);
+        ti.context = &cxt;
+    }
+    else
+        ti.interpreter->set_cell(cell);
+
+    ti.in_use = true;
+    m_borrowed = true;
+    mp_interpreter = ti.interpreter.get();
+}
+
+formula_interpreter_lease::~formula_interpreter_lease()
+{
+    mp_interpreter->reset();
+
+    if (m_borrowed)
+        tl_interpreter.in_use = false;
+}
+
+formula_interpreter& formula_interpreter_lease::get()
+{
+    return *mp_interpreter;
 }
 
 }
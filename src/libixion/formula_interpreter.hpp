@@ -13,6 +13,7 @@
 #include "ixion/formula_result.hpp"
 
 #include "formula_value_stack.hpp"
+#include "formula_program.hpp"
 
 #include <sstream>
 #include <unordered_set>
@@ -33,14 +34,16 @@ class session_handler;
  * The formula interpreter parses a series of formula tokens representing a
  * formula expression, and calculates the result of that expression.
  *
- * <p>Intermediate result of each handler is pushed onto the stack and
- * popped from it for the calling method to retrieve.  By the end of the
- * interpretation there should only be one result left on the stack which is
- * the final result of the interpretation of the expression.  The number of
- * intermediate results (or stack values) on the stack is normally one at
- * the end of each handler, except for the function handler where the number
- * of stack values may be more than one when the function may take more than
- * one argument.</p>
+ * <p>The tokens are first compiled into a formula program, which is a flat
+ * sequence of instructions in postfix order.  The program is then run in a
+ * single loop.  The compiled program can be handed back to the interpreter
+ * for subsequent interpretations of the same expression, in which case the
+ * compilation step is skipped entirely.</p>
+ *
+ * <p>During the run, intermediate result of each instruction is pushed onto
+ * the stack and popped from it by the subsequent instructions.  By the end
+ * of the run there should only be one result left on the stack which is the
+ * final result of the interpretation of the expression.</p>
  */
 class formula_interpreter
 {
@@ -57,11 +60,55 @@ public:
     formula_interpreter(const formula_cell* cell, iface::formula_model_access& cxt);
     ~formula_interpreter();
 
+    /**
+     * Set the formula cell to interpret next.  This allows the same
+     * interpreter instance to be used to interpret multiple cells in the
+     * same model context.
+     *
+     * @param cell formula cell to interpret next.
+     */
+    void set_cell(const formula_cell* cell);
+
     void set_origin(const abs_address_t& pos);
+
+    /**
+     * Set a program compiled during an earlier interpretation of the same
+     * formula expression, in order to skip compilation.  The program is
+     * ignored when a session handler is present, since the handler receives
+     * the tokens as they get compiled.
+     *
+     * @param program compiled program, or nullptr to always compile.
+     */
+    void set_program(const formula_program* program);
+
+    /**
+     * Release the program compiled during the last interpretation, provided
+     * that it can be reused in later interpretations of the same expression.
+     * A program compiled from a formula expression that refers to named
+     * expressions is not reusable, since the named expressions may change.
+     *
+     * @return compiled program, or nullptr if no reusable program is
+     *         available.
+     */
+    std::unique_ptr<formula_program> release_program();
+
     bool interpret();
-    formula_result transfer_result();
+    /**
+     * Move the result of the last interpretation into the specified
+     * destination.  The previous content of the destination gets discarded
+     * when this instance is reset.
+     *
+     * @param dest destination to move the result into.
+     */
+    void transfer_result(formula_result& dest);
     formula_error_t get_error() const;
 
+    /**
+     * Release the values and the session handler left from the last
+     * interpretation.  All internal containers keep their storage.
+     */
+    void reset();
+
 private:
     /**
      * Expand all named expressions into a flat set of tokens.  This is also
@@ -80,10 +127,18 @@ private:
     const formula_token& token_or_throw() const;
     const formula_token& next_token();
 
-    // The following methods are handlers.  In each handler, the initial
-    // position is always set to the first unprocessed token.  Each handler is
-    // responsible for setting the token position to the next unprocessed
-    // position when it finishes.
+    /**
+     * Compile the flattened tokens into a program.
+     *
+     * @return true if all tokens have been compiled, or false if the
+     *         expression ended before the last token.
+     */
+    bool compile();
+
+    // The following methods are compile handlers.  In each handler, the
+    // initial position is always set to the first unprocessed token.  Each
+    // handler is responsible for setting the token position to the next
+    // unprocessed position when it finishes.
 
     void expression();
     void term();
@@ -97,6 +152,10 @@ private:
     void literal();
     void function();
 
+    void emit(program_op_t op);
+
+    void run(const formula_program& program);
+
     void clear_stacks();
     void push_stack();
     void pop_stack();
@@ -109,15 +168,49 @@ private:
     std::unique_ptr<iface::session_handler> mp_handler;
     abs_address_t m_pos;
 
+    /**
+     * Value stacks, one for each level of nested function calls.  Only the
+     * first m_stack_depth stacks are in use.  The stacks are only cleared
+     * between interpretations, so that their storage gets reused.
+     */
     fv_stacks_type m_stacks;
+    size_t m_stack_depth;
     local_tokens_type m_tokens;
     local_tokens_type::const_iterator m_cur_token_itr;
     local_tokens_type::const_iterator m_end_token_pos;
+    bool m_has_named_expression;
+
+    const formula_program* mp_cached_program;
+    std::unique_ptr<formula_program> mp_program;
+    bool m_program_reusable;
 
     formula_result m_result;
     formula_error_t m_error;
 };
 
+/**
+ * Lends the formula interpreter instance owned by the current thread for
+ * the lifetime of the lease.  The same instance is used to interpret all
+ * formula cells on the same thread, so that its containers keep their
+ * storage between the cells.  When the instance of the current thread is
+ * already lent, or it belongs to a different model context, a new instance
+ * is created for the lease.
+ */
+class formula_interpreter_lease
+{
+    formula_interpreter* mp_interpreter;
+    std::unique_ptr<formula_interpreter> mp_own;
+    bool m_borrowed;
+
+public:
+    formula_interpreter_lease(const formula_cell* cell, iface::formula_model_access& cxt);
+    formula_interpreter_lease(const formula_interpreter_lease&) = delete;
+    formula_interpreter_lease& operator= (const formula_interpreter_lease&) = delete;
+    ~formula_interpreter_lease();
+
+    formula_interpreter& get();
+};
+
 }
 
 #endif
@@ -0,0 +1,155 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef INCLUDED_IXION_FORMULA_PROGRAM_HPP
+#define INCLUDED_IXION_FORMULA_PROGRAM_HPP
+
+#include "ixion/address.hpp"
+#include "ixion/table.hpp"
+#include "ixion/formula_opcode.hpp"
+#include "ixion/formula_function_opcode.hpp"
+
+#include <vector>
+#include <memory>
+
+namespace ixion {
+
+class formula_tokens_store;
+
+/**
+ * Operation code of a single instruction in a compiled formula program.
+ */
+enum class program_op_t : uint8_t
+{
+    /** Push the inline numeric value. */
+    value,
+    /** Push the string whose ID is stored inline. */
+    string,
+    /** Push a single cell reference stored in the reference table. */
+    single_ref,
+    /** Push a range reference stored in the reference table. */
+    range_ref,
+    /** Push the range of a table reference stored in the reference table. */
+    table_ref,
+    /** Convert the top stack value to a numeric value. */
+    to_value,
+    /** Convert the top stack value to a string value. */
+    to_string,
+    /**
+     * Convert the top stack value to either a numeric or a string value, by
+     * fetching the value of the referenced cell if it's a reference.
+     */
+    to_scalar,
+    /** Negate the top stack value. */
+    negate,
+    /**
+     * Apply one of the additive or comparison operators, stored inline, on
+     * the two top stack values.
+     */
+    expression_op,
+    multiply,
+    divide,
+    exponent,
+    concat,
+    /** Start a new stack to store the arguments of a function. */
+    begin_function,
+    /**
+     * Call the function stored inline with the arguments on the current
+     * stack, and push its result to the previous stack.
+     */
+    function,
+};
+
+/**
+ * Single instruction of a compiled formula program.  The meaning of the
+ * operand depends on the operation code.
+ */
+struct program_instruction
+{
+    struct function_call
+    {
+        formula_function_t oc;
+        uint16_t arg_count;
+    };
+
+    program_op_t op;
+
+    union
+    {
+        double value;
+        uint32_t index;
+        fopcode_t oc;
+        function_call func;
+    };
+
+    program_instruction(program_op_t _op) : op(_op), index(0) {}
+};
+
+/**
+ * Formula expression compiled into a flat sequence of instructions in
+ * postfix order.  The references are stored in their original relative
+ * form, so that the same program can run at any cell position.
+ */
+struct formula_program
+{
+    std::vector<program_instruction> code;
+    std::vector<address_t> single_refs;
+    std::vector<range_t> range_refs;
+    std::vector<table_t> table_refs;
+
+    void clear()
+    {
+        code.clear();
+        single_refs.clear();
+        range_refs.clear();
+        table_refs.clear();
+    }
+};
+
+namespace detail {
+
+/**
+ * Provides access to the program compiled from the tokens of a token
+ * store.  The program is shared by all formula cells that share the token
+ * store, and is discarded when mutable access to the tokens is requested.
+ */
+class formula_program_cache
+{
+public:
+    /**
+     * Get the program compiled from the tokens of a token store.
+     *
+     * @param ts token store.
+     *
+     * @return pointer to the compiled program, or nullptr if the tokens
+     *         have not been compiled yet.
+     */
+    static const formula_program* get(const formula_tokens_store& ts);
+
+    /**
+     * Store a program compiled from the tokens of a token store, unless
+     * another program has already been stored.  This method can be called
+     * concurrently from multiple threads.
+     *
+     * @param ts token store.
+     * @param program program compiled from the tokens.
+     *
+     * @return pointer to the program stored in the token store, which is
+     *         not the passed program if another program has been stored
+     *         first.
+     */
+    static const formula_program* set(
+        formula_tokens_store& ts, std::unique_ptr<formula_program> program);
+};
+
+}
+
+}
+
+#endif
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
@@ -355,6 +355,13 @@ formula_result::~formula_result() {}
 
 void formula_result::reset()
 {
+    if (!mp_impl)
+    {
+        // The content has been moved out.  Make it usable again.
+        mp_impl = std::make_unique<impl>();
+        return;
+    }
+
     mp_impl->reset();
 }
 
@@ -378,6 +385,11 @@ void formula_result::set_matrix(matrix mtx)
     mp_impl->set_matrix(std::move(mtx));
 }
 
+void formula_result::swap(formula_result& r)
+{
+    mp_impl.swap(r.mp_impl);
+}
+
 double formula_result::get_value() const
 {
     return mp_impl->get_value();
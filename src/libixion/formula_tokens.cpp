@@ -10,6 +10,10 @@
 #include <ixion/global.hpp>
 #include <ixion/macros.hpp>
 
+#include "formula_program.hpp"
+
+#include <atomic>
+
 namespace ixion {
 
 std::string_view get_opcode_name(fopcode_t oc)
@@ -186,7 +190,19 @@ struct formula_tokens_store::impl
     formula_tokens_t m_tokens;
     size_t m_refcount;
 
-    impl() : m_refcount(0) {}
+    /**
+     * Program compiled from the tokens.  Once stored, it stays until
+     * mutable access to the tokens is requested, so readers don't need to
+     * hold a reference.
+     */
+    std::atomic<formula_program*> mp_program;
+
+    impl() : m_refcount(0), mp_program(nullptr) {}
+
+    ~impl()
+    {
+        delete mp_program.load();
+    }
 };
 
 formula_tokens_store::formula_tokens_store() :
@@ -221,6 +237,9 @@ size_t formula_tokens_store::get_reference_count() const
 
 formula_tokens_t& formula_tokens_store::get()
 {
+    // The caller may modify the tokens, which would leave the program
+    // compiled from them stale.
+    delete mp_impl->mp_program.exchange(nullptr, std::memory_order_acq_rel);
     return mp_impl->m_tokens;
 }
 
@@ -229,6 +248,27 @@ const formula_tokens_t& formula_tokens_store::get() const
     return mp_impl->m_tokens;
 }
 
+namespace detail {
+
+const formula_program* formula_program_cache::get(const formula_tokens_store& ts)
+{
+    return ts.mp_impl->mp_program.load(std::memory_order_acquire);
+}
+
+const formula_program* formula_program_cache::set(
+    formula_tokens_store& ts, std::unique_ptr<formula_program> program)
+{
+    formula_program* expected = nullptr;
+    if (ts.mp_impl->mp_program.compare_exchange_strong(
+        expected, program.get(), std::memory_order_acq_rel, std::memory_order_acquire))
+        return program.release();
+
+    // Another thread has stored its program first.
+    return expected;
+}
+
+}
+
 named_expression_t::named_expression_t() {}
 named_expression_t::named_expression_t(const abs_address_t& _origin, formula_tokens_t _tokens) :
     origin(_origin), tokens(std::move(_tokens)) {}
@@ -17,6 +17,7 @@
 
 #include <string>
 #include <sstream>
+#include <new>
 
 namespace ixion {
 
@@ -51,13 +52,13 @@ stack_value::stack_value(double val) :
     m_type(stack_value_t::value), m_value(val) {}
 
 stack_value::stack_value(std::string str) :
-    m_type(stack_value_t::string), m_str(new std::string(std::move(str))) {}
+    m_type(stack_value_t::string), m_str(std::move(str)) {}
 
 stack_value::stack_value(const abs_address_t& val) :
-    m_type(stack_value_t::single_ref), m_address(new abs_address_t(val)) {}
+    m_type(stack_value_t::single_ref), m_address(val) {}
 
 stack_value::stack_value(const abs_range_t& val) :
-    m_type(stack_value_t::range_ref), m_range(new abs_range_t(val)) {}
+    m_type(stack_value_t::range_ref), m_range(val) {}
 
 stack_value::stack_value(matrix mtx) :
     m_type(stack_value_t::matrix), m_matrix(new matrix(std::move(mtx))) {}
@@ -65,8 +66,28 @@ stack_value::stack_value(matrix mtx) :
 stack_value::stack_value(stack_value&& other) :
     m_type(other.m_type)
 {
-    other.m_type = stack_value_t::value;
+    move_from(other);
+}
+
+stack_value::~stack_value()
+{
+    destroy();
+}
+
+stack_value& stack_value::operator= (stack_value&& other)
+{
+    if (this == &other)
+        return *this;
 
+    destroy();
+    m_type = other.m_type;
+    move_from(other);
+
+    return *this;
+}
+
+void stack_value::move_from(stack_value& other)
+{
     switch (m_type)
     {
         case stack_value_t::matrix:
@@ -74,16 +95,13 @@ stack_value::stack_value(stack_value&& other) :
             other.m_matrix = nullptr;
             break;
         case stack_value_t::range_ref:
-            m_range = other.m_range;
-            other.m_range = nullptr;
+            new (&m_range) abs_range_t(other.m_range);
             break;
         case stack_value_t::single_ref:
-            m_address = other.m_address;
-            other.m_address = nullptr;
+            new (&m_address) abs_address_t(other.m_address);
             break;
         case stack_value_t::string:
-            m_str = other.m_str;
-            other.m_str = nullptr;
+            new (&m_str) std::string(std::move(other.m_str));
             break;
         case stack_value_t::value:
             m_value = other.m_value;
@@ -91,60 +109,25 @@ stack_value::stack_value(stack_value&& other) :
         default:
             ;
     }
-}
 
-stack_value::~stack_value()
-{
-    switch (m_type)
-    {
-        case stack_value_t::range_ref:
-            delete m_range;
-            break;
-        case stack_value_t::single_ref:
-            delete m_address;
-            break;
-        case stack_value_t::matrix:
-            delete m_matrix;
-            break;
-        case stack_value_t::string:
-            delete m_str;
-            break;
-        case stack_value_t::value:
-        default:
-            ; // do nothing
-    }
+    other.destroy();
+    other.m_type = stack_value_t::value;
+    other.m_value = 0.0;
 }
 
-stack_value& stack_value::operator= (stack_value&& other)
+void stack_value::destroy()
 {
-    other.m_type = stack_value_t::value;
-
     switch (m_type)
     {
         case stack_value_t::matrix:
-            m_matrix = other.m_matrix;
-            other.m_matrix = nullptr;
-            break;
-        case stack_value_t::range_ref:
-            m_range = other.m_range;
-            other.m_range = nullptr;
-            break;
-        case stack_value_t::single_ref:
-            m_address = other.m_address;
-            other.m_address = nullptr;
+            delete m_matrix;
             break;
         case stack_value_t::string:
-            m_str = other.m_str;
-            other.m_str = nullptr;
-            break;
-        case stack_value_t::value:
-            m_value = other.m_value;
+            m_str.~basic_string();
             break;
         default:
-            ;
+            ; // nothing to release.
     }
-
-    return *this;
 }
 
 stack_value_t stack_value::get_type() const
@@ -169,17 +152,17 @@ double stack_value::get_value() const
 
 const std::string& stack_value::get_string() const
 {
-    return *m_str;
+    return m_str;
 }
 
 const abs_address_t& stack_value::get_address() const
 {
-    return *m_address;
+    return m_address;
 }
 
 const abs_range_t& stack_value::get_range() const
 {
-    return *m_range;
+    return m_range;
 }
 
 matrix stack_value::pop_matrix()
@@ -203,6 +186,14 @@ matrix stack_value::pop_matrix()
     }
 }
 
+std::string stack_value::pop_string()
+{
+    if (m_type != stack_value_t::string)
+        throw formula_error(formula_error_t::stack_error);
+
+    return std::move(m_str);
+}
+
 formula_value_stack::formula_value_stack(const iface::formula_model_access& cxt) : m_context(cxt) {}
 
 formula_value_stack::iterator formula_value_stack::begin()
@@ -331,19 +322,19 @@ double formula_value_stack::pop_value()
     return ret;
 }
 
-const std::string formula_value_stack::pop_string()
+std::string formula_value_stack::pop_string()
 {
     IXION_TRACE("pop_string");
 
     if (m_stack.empty())
         throw formula_error(formula_error_t::stack_error);
 
-    const stack_value& v = m_stack.back();
+    stack_value& v = m_stack.back();
     switch (v.get_type())
     {
         case stack_value_t::string:
         {
-            const std::string str = v.get_string();
+            std::string str = v.pop_string();
             m_stack.pop_back();
             return str;
         }
@@ -9,8 +9,10 @@
 #define INCLUDED_IXION_FORMULA_VALUE_STACK_HPP
 
 #include "ixion/global.hpp"
+#include "ixion/address.hpp"
 
-#include <deque>
+#include <string>
+#include <vector>
 
 namespace ixion {
 
@@ -20,8 +22,6 @@ class formula_model_access;
 
 }
 
-struct abs_address_t;
-struct abs_range_t;
 class matrix;
 
 /**
@@ -38,7 +38,10 @@ enum class stack_value_t
 };
 
 /**
- * Individual stack value storage.
+ * Individual stack value storage.  Numeric values, references and strings
+ * are stored inline, and only matrix values are allocated separately.  A
+ * short string fits in the small buffer of std::string and does not
+ * allocate either.
  */
 class stack_value
 {
@@ -47,12 +50,21 @@ class stack_value
     union
     {
         double m_value;
-        abs_address_t* m_address;
-        abs_range_t* m_range;
+        abs_address_t m_address;
+        abs_range_t m_range;
         matrix* m_matrix;
-        std::string* m_str;
+        std::string m_str;
     };
 
+    /**
+     * Move the value of another instance into this instance whose value
+     * storage is not initialized.  The other instance becomes a numeric
+     * value of 0.
+     */
+    void move_from(stack_value& other);
+
+    void destroy();
+
 public:
     stack_value() = delete;
     stack_value(const stack_value&) = delete;
@@ -79,14 +91,22 @@ public:
      * will be empty after this call.
      */
     matrix pop_matrix();
+
+    /**
+     * Move the string value out from storage.  The internal string will be
+     * empty after this call.
+     */
+    std::string pop_string();
 };
 
 /**
- * FILO stack of values; last pushed value gets popped first.
+ * FILO stack of values; last pushed value gets popped first.  Clearing the
+ * stack keeps the capacity of its storage, so that a stack instance can be
+ * reused without allocating memory again.
  */
 class formula_value_stack
 {
-    typedef std::deque<stack_value> store_type;
+    typedef std::vector<stack_value> store_type;
     store_type m_stack;
     const iface::formula_model_access& m_context;
 
@@ -125,7 +145,7 @@ public:
     void push_matrix(matrix mtx);
 
     double pop_value();
-    const std::string pop_string();
+    std::string pop_string();
     abs_address_t pop_single_ref();
     abs_range_t pop_range_ref();
     matrix pop_range_value();
@@ -8,9 +8,41 @@
 #include "ixion/interface/table_handler.hpp"
 #include "ixion/interface/session_handler.hpp"
 #include "ixion/interface/formula_model_access.hpp"
+#include "ixion/address.hpp"
+#include "ixion/formula_result.hpp"
+#include "ixion/exceptions.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <sstream>
 
 namespace ixion { namespace iface {
 
+namespace {
+
+column_block_t to_column_block_type(celltype_t type)
+{
+    switch (type)
+    {
+        case celltype_t::empty:
+            return column_block_t::empty;
+        case celltype_t::boolean:
+            return column_block_t::boolean;
+        case celltype_t::numeric:
+            return column_block_t::numeric;
+        case celltype_t::string:
+            return column_block_t::string;
+        case celltype_t::formula:
+            return column_block_t::formula;
+        default:
+            ;
+    }
+
+    return column_block_t::unknown;
+}
+
+}
+
 table_handler::~table_handler() {}
 
 session_handler::~session_handler() {}
@@ -18,6 +50,129 @@ session_handler::~session_handler() {}
 formula_model_access::formula_model_access() {}
 formula_model_access::~formula_model_access() {}
 
+void formula_model_access::walk(sheet_t sheet, const abs_rc_range_t& range, column_block_callback_t cb) const
+{
+    if (!range.valid())
+        throw std::invalid_argument("invalid range.");
+
+    rc_size_t ss = get_sheet_size();
+
+    col_t col_first = range.first.column, col_last = range.last.column;
+    if (range.all_columns())
+    {
+        col_first = 0;
+        col_last = ss.column - 1;
+    }
+
+    row_t row_first = range.first.row, row_last = range.last.row;
+    if (range.all_rows())
+    {
+        row_first = 0;
+        row_last = ss.row - 1;
+    }
+
+    col_last = std::min<col_t>(col_last, ss.column - 1);
+    row_last = std::min<row_t>(row_last, ss.row - 1);
+
+    for (col_t col = col_first; col <= col_last; ++col)
+    {
+        row_t row = row_first;
+        while (row <= row_last)
+        {
+            // Extend the block for as long as the cell type stays the same.
+            column_block_t type = to_column_block_type(get_celltype(abs_address_t(sheet, row, col)));
+            row_t block_end = row;
+            while (block_end < row_last &&
+                to_column_block_type(get_celltype(abs_address_t(sheet, block_end + 1, col))) == type)
+                ++block_end;
+
+            column_block_shape_t shape(row, block_end - row + 1, 0, type, nullptr);
+            if (!cb(col, row, block_end, shape))
+                return;
+
+            row = block_end + 1;
+        }
+    }
+}
+
+void formula_model_access::publish_formula_result(const abs_address_t& /*pos*/, const formula_cell& /*cell*/)
+{
+}
+
+void formula_model_access::reset_formula_result(const abs_address_t& /*pos*/)
+{
+}
+
+void formula_model_access::fold_numeric(const abs_range_t& range, numeric_array_callback_t cb) const
+{
+    if (!range.valid())
+    {
+        std::ostringstream os;
+        os << "invalid range: " << range;
+        throw std::invalid_argument(os.str());
+    }
+
+    constexpr size_t buf_capacity = 64;
+    double buf[buf_capacity];
+    size_t buf_size = 0;
+
+    auto push = [&](double v)
+    {
+        buf[buf_size++] = v;
+        if (buf_size == buf_capacity)
+        {
+            cb(buf, buf_size);
+            buf_size = 0;
+        }
+    };
+
+    sheet_t sheet = range.first.sheet;
+
+    column_block_callback_t walk_cb = [&](col_t col, row_t row1, row_t row2, const column_block_shape_t& node)
+    {
+        for (row_t row = row1; row <= row2; ++row)
+        {
+            abs_address_t addr(sheet, row, col);
+
+            switch (node.type)
+            {
+                case column_block_t::numeric:
+                    push(get_numeric_value(addr));
+                    break;
+                case column_block_t::boolean:
+                    push(get_boolean_value(addr) ? 1.0 : 0.0);
+                    break;
+                case column_block_t::formula:
+                {
+                    formula_result res = get_formula_result(addr);
+                    switch (res.get_type())
+                    {
+                        case formula_result::result_type::value:
+                            push(res.get_value());
+                            break;
+                        case formula_result::result_type::error:
+                            throw formula_error(res.get_error());
+                        default:
+                            ;
+                    }
+                    break;
+                }
+                default:
+                    // Skip the rest of the block in one step.
+                    return true;
+            }
+        }
+
+        return true;
+    };
+
+    for (; sheet <= range.last.sheet; ++sheet)
+        walk(sheet, range, walk_cb);
+
+    if (buf_size)
+        cb(buf, buf_size);
+}
+
 std::unique_ptr<session_handler> formula_model_access::create_session_handler()
 {
     return std::unique_ptr<session_handler>();
@@ -14,6 +14,7 @@
 #include "ixion/global.hpp"
 #include "ixion/macros.hpp"
 #include "ixion/interface/table_handler.hpp"
+#include "ixion/interface/session_handler.hpp"
 #include "ixion/config.hpp"
 #include "ixion/matrix.hpp"
 #include "ixion/cell.hpp"
@@ -1393,6 +1394,9 @@ void test_model_context_storage()
 
         cxt.append_sheet("test");
 
+        // No session handler gets created unless a factory is registered.
+        assert(!cxt.create_session_handler());
+
         // Test empty cell access.
         cell_access ca = cxt.get_cell_access(abs_address_t(0, 0, 0));
         assert(ca.get_type() == celltype_t::empty);
@@ -2264,6 +2268,107 @@ void test_model_context_error_value()
     assert(ca.get_error_value() == formula_error_t::division_by_zero);
 }
 
+void test_model_context_range_value()
+{
+    cout << "test model context range value" << endl;
+
+    model_context cxt{{100, 10}};
+    cxt.append_sheet("test");
+
+    auto resolver = formula_name_resolver::get(formula_name_resolver_t::excel_a1, &cxt);
+    assert(resolver);
+
+    // B1:B6 contains a mixture of numeric, boolean, string and empty cells,
+    // as well as a formula cell.  B3 is left empty.
+    cxt.set_numeric_cell(abs_address_t(0, 0, 1), 1.5);
+    cxt.set_numeric_cell(abs_address_t(0, 1, 1), 2.5);
+    cxt.set_boolean_cell(abs_address_t(0, 3, 1), true);
+    cxt.set_string_cell(abs_address_t(0, 4, 1), "text");
+
+    abs_address_t pos(0, 5, 1);
+    formula_tokens_t tokens = parse_formula_string(cxt, pos, *resolver, "B1*2");
+    formula_cell* fc = cxt.set_formula_cell(pos, std::move(tokens));
+    fc->interpret(cxt, pos);
+
+    // Fetch a range that extends past the last non-empty row and into the
+    // empty column.
+    abs_range_t range(0, 0, 1, 8, 2);
+    matrix mx = cxt.get_range_value(range);
+    assert(mx.row_size() == 8);
+    assert(mx.col_size() == 2);
+
+    matrix::element elem = mx.get(0, 0);
+    assert(elem.type == matrix::element_type::numeric);
+    assert(std::get<double>(elem.value) == 1.5);
+
+    elem = mx.get(1, 0);
+    assert(elem.type == matrix::element_type::numeric);
+    assert(std::get<double>(elem.value) == 2.5);
+
+    assert(mx.get(2, 0).type == matrix::element_type::empty);
+
+    elem = mx.get(3, 0);
+    assert(elem.type == matrix::element_type::boolean);
+    assert(std::get<bool>(elem.value) == true);
+
+    elem = mx.get(4, 0);
+    assert(elem.type == matrix::element_type::string);
+    assert(std::get<std::string_view>(elem.value) == "text");
+
+    elem = mx.get(5, 0);
+    assert(elem.type == matrix::element_type::numeric);
+    assert(std::get<double>(elem.value) == 3.0);
+
+    for (size_t row = 6; row < 8; ++row)
+        assert(mx.get(row, 0).type == matrix::element_type::empty);
+
+    for (size_t row = 0; row < 8; ++row)
+        assert(mx.get(row, 1).type == matrix::element_type::empty);
+}
+
+void test_shared_formula_program()
+{
+    cout << "test shared formula program" << endl;
+
+    model_context cxt{{100, 10}};
+    cxt.append_sheet("test");
+
+    auto resolver = formula_name_resolver::get(formula_name_resolver_t::excel_a1, &cxt);
+    assert(resolver);
+
+    for (row_t row = 0; row < 3; ++row)
+        cxt.set_numeric_cell(abs_address_t(0, row, 0), row + 1.0);
+
+    // Share the same tokens among B1:B3.
+    abs_address_t pos(0, 0, 1);
+    auto ts = formula_tokens_store::create();
+    ts->get() = parse_formula_string(cxt, pos, *resolver, "A1*2");
+
+    // The program compiled for the first cell is used by all the others.
+    for (row_t row = 0; row < 3; ++row)
+    {
+        pos.row = row;
+        formula_cell* fc = cxt.set_formula_cell(pos, ts);
+        assert(fc);
+        fc->interpret(cxt, pos);
+        assert(fc->get_value(formula_result_wait_policy_t::throw_exception) == (row + 1.0) * 2.0);
+    }
+
+    // Modifying the shared tokens must discard the compiled program.
+    pos.row = 0;
+    ts->get() = parse_formula_string(cxt, pos, *resolver, "A1*3");
+
+    for (row_t row = 0; row < 3; ++row)
+    {
+        pos.row = row;
+        formula_cell* fc = cxt.get_formula_cell(pos);
+        assert(fc);
+        fc->reset(cxt, pos);
+        fc->interpret(cxt, pos);
+        assert(fc->get_value(formula_result_wait_policy_t::throw_exception) == (row + 1.0) * 3.0);
+    }
+}
+
 void test_volatile_function()
 {
     cout << "test volatile function" << endl;
@@ -2384,6 +2489,163 @@ void test_grouped_formula_string_results()
     assert(s == "literal string");
 }
 
+void test_formula_result_column()
+{
+    cout << "test formula result column" << endl;
+
+    model_context cxt{{100, 10}};
+    auto resolver = formula_name_resolver::get(formula_name_resolver_t::excel_a1, &cxt);
+    assert(resolver);
+
+    cxt.append_sheet("test");
+
+    abs_range_set_t dirty_cells;
+    abs_range_set_t modified_cells;
+
+    // A1:A4 contain values, B1:B4 double them, and C1 sums B1:B4.
+    for (row_t row = 0; row < 4; ++row)
+    {
+        cxt.set_numeric_cell(abs_address_t(0, row, 0), row + 1.0);
+        abs_address_t pos(0, row, 1);
+        std::string exp = "A" + std::to_string(row + 1) + "*2";
+        insert_formula(cxt, pos, exp.data(), *resolver);
+        dirty_cells.insert(pos);
+    }
+
+    insert_formula(cxt, abs_address_t(0, 0, 2), "SUM(B1:B4)", *resolver);
+    dirty_cells.insert(abs_address_t(0, 0, 2));
+
+    auto sorted = ixion::query_and_sort_dirty_cells(cxt, modified_cells, &dirty_cells);
+    ixion::calculate_sorted_cells(cxt, sorted, 0);
+
+    assert(cxt.get_numeric_value(abs_address_t(0, 0, 2)) == 20.0);
+
+    matrix m = cxt.get_range_value(abs_range_t(0, 0, 1, 4, 1));
+    for (row_t row = 0; row < 4; ++row)
+        assert(m.get_numeric(row, 0) == (row + 1.0) * 2.0);
+
+    // Modify A2, which makes B2 and C1 dirty.
+    modified_cells.clear();
+    dirty_cells.clear();
+    cxt.set_numeric_cell(abs_address_t(0, 1, 0), 10.0);
+    modified_cells.insert(abs_address_t(0, 1, 0));
+    sorted = ixion::query_and_sort_dirty_cells(cxt, modified_cells, &dirty_cells);
+    assert(sorted.size() == 2);
+    ixion::calculate_sorted_cells(cxt, sorted, 0);
+
+    assert(cxt.get_numeric_value(abs_address_t(0, 1, 1)) == 20.0);
+    assert(cxt.get_numeric_value(abs_address_t(0, 0, 2)) == 36.0);
+
+    // Overwrite B4 with a string.  Its previous result must no longer be
+    // picked up.
+    modified_cells.clear();
+    dirty_cells.clear();
+    unregister_formula_cell(cxt, abs_address_t(0, 3, 1));
+    cxt.set_string_cell(abs_address_t(0, 3, 1), "text");
+    modified_cells.insert(abs_address_t(0, 3, 1));
+    sorted = ixion::query_and_sort_dirty_cells(cxt, modified_cells, &dirty_cells);
+    ixion::calculate_sorted_cells(cxt, sorted, 0);
+
+    assert(cxt.get_numeric_value(abs_address_t(0, 0, 2)) == 28.0);
+    assert(cxt.count_range(abs_range_t(0, 0, 1, 4, 1), values_t(value_numeric)) == 3.0);
+}
+
+void test_value_change_cutoff()
+{
+    cout << "test value change cutoff" << endl;
+
+    model_context cxt{{100, 10}};
+    auto resolver = formula_name_resolver::get(formula_name_resolver_t::excel_a1, &cxt);
+    assert(resolver);
+
+    cxt.append_sheet("test");
+
+    abs_address_t A1(0, 0, 0), A2(0, 1, 0), B1(0, 0, 1), C1(0, 0, 2);
+
+    cxt.set_numeric_cell(A1, 1.0);
+    cxt.set_numeric_cell(A2, 5.0);
+
+    // B1 always evaluates to 0 regardless of A1.
+    formula_cell* b1 = insert_formula(cxt, B1, "A1*0", *resolver);
+    formula_cell* c1 = insert_formula(cxt, C1, "B1+A2", *resolver);
+
+    abs_range_set_t modified_cells;
+    abs_range_set_t dirty_cells;
+    dirty_cells.insert(B1);
+    dirty_cells.insert(C1);
+
+    auto sorted = ixion::query_and_sort_dirty_cells(cxt, modified_cells, &dirty_cells);
+    ixion::calculate_sorted_cells(cxt, sorted, 0, modified_cells, &dirty_cells);
+    assert(cxt.get_numeric_value(C1) == 5.0);
+    assert(b1->has_result_changed());
+    assert(c1->has_result_changed());
+
+    // Modifying A1 doesn't change B1, so C1 keeps its previous result.
+    cxt.set_numeric_cell(A1, 2.0);
+    modified_cells.insert(A1);
+    dirty_cells.clear();
+    sorted = ixion::query_and_sort_dirty_cells(cxt, modified_cells);
+    assert(sorted.size() == 2);
+    ixion::calculate_sorted_cells(cxt, sorted, 0, modified_cells);
+    assert(!b1->has_result_changed());
+    assert(!c1->has_result_changed());
+    assert(cxt.get_numeric_value(C1) == 5.0);
+
+    // Modifying A2 affects C1 directly.
+    cxt.set_numeric_cell(A2, 7.0);
+    modified_cells.clear();
+    modified_cells.insert(A2);
+    sorted = ixion::query_and_sort_dirty_cells(cxt, modified_cells);
+    ixion::calculate_sorted_cells(cxt, sorted, 0, modified_cells);
+    assert(c1->has_result_changed());
+    assert(cxt.get_numeric_value(C1) == 7.0);
+}
+
+void test_partially_registered_circular()
+{
+    cout << "test partially registered circular" << endl;
+
+    model_context cxt{{100, 10}};
+    auto resolver = formula_name_resolver::get(formula_name_resolver_t::excel_a1, &cxt);
+    assert(resolver);
+
+    cxt.append_sheet("test");
+
+    abs_address_t A1(0, 0, 0), A2(0, 1, 0), A3(0, 2, 0);
+    abs_address_t B1(0, 0, 1), C1(0, 0, 2), D1(0, 0, 3), E1(0, 0, 4);
+
+    cxt.set_numeric_cell(E1, 3.0);
+
+    // B1 and C1 are registered, thus known to the cell tracker.
+    insert_formula(cxt, B1, "A1+1", *resolver);
+    insert_formula(cxt, C1, "B1*2", *resolver);
+
+    // The rest are not registered.  A1 references itself, and A2 and A3
+    // reference each other.
+    auto insert_unregistered = [&](const abs_address_t& pos, const char* exp)
+    {
+        formula_tokens_t tokens = parse_formula_string(cxt, pos, *resolver, exp);
+        cxt.set_formula_cell(pos, std::move(tokens));
+    };
+
+    insert_unregistered(A1, "A1");
+    insert_unregistered(A2, "A3");
+    insert_unregistered(A3, "A2");
+    insert_unregistered(D1, "E1*2");
+
+    std::vector<abs_range_t> sorted = { A1, B1, C1, A2, A3, D1 };
+    ixion::calculate_sorted_cells(cxt, sorted, 0);
+
+    for (const abs_address_t& pos : { A1, B1, C1, A2, A3 })
+    {
+        cell_access ca = cxt.get_cell_access(pos);
+        assert(ca.get_value_type() == cell_value_t::error);
+        assert(ca.get_error_value() == formula_error_t::ref_result_not_available);
+    }
+
+    assert(cxt.get_numeric_value(D1) == 6.0);
+}
+
 } // anonymous namespace
 
 int main()
@@ -2415,9 +2677,14 @@ int main()
     test_model_context_iterator_named_exps();
     test_model_context_fill_down();
     test_model_context_error_value();
+    test_model_context_range_value();
+    test_shared_formula_program();
     test_volatile_function();
     test_invalid_formula_tokens();
     test_grouped_formula_string_results();
+    test_formula_result_column();
+    test_value_change_cutoff();
+    test_partially_registered_circular();
 
     return EXIT_SUCCESS;
 }
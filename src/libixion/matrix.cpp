@@ -12,6 +12,9 @@
 #include <limits>
 #include <cstring>
 #include <functional>
+#include <stdexcept>
+#include <iterator>
+#include <algorithm>
 
 namespace ixion {
 
@@ -151,6 +154,17 @@ void matrix::set(size_t row, size_t col, formula_error_t val)
     mp_impl->m_data.set(row, col, encoded);
 }
 
+void matrix::set(size_t row, size_t col, const double* first, const double* last)
+{
+    if (first == last)
+        return;
+
+    if (row + std::distance(first, last) > row_size())
+        throw std::out_of_range("sequence of values does not fit in the column.");
+
+    mp_impl->m_data.set(row, col, first, last);
+}
+
 matrix::element matrix::get(size_t row, size_t col) const
 {
     element me;
@@ -255,6 +269,13 @@ numeric_matrix matrix::as_numeric() const
                     std::advance(dest, node.size);
                     break;
                 }
+                case mdds::mtm::element_empty:
+                {
+                    // Empty elements are handled as numeric values of 0.0.
+                    std::fill_n(dest, node.size, 0.0);
+                    std::advance(dest, node.size);
+                    break;
+                }
                 default:
                     ;
             }
@@ -17,6 +17,16 @@
 
 namespace ixion {
 
+namespace detail {
+
+thread_pool* model_thread_pool::get(iface::formula_model_access& cxt, size_t thread_count)
+{
+    model_context* p = dynamic_cast<model_context*>(&cxt);
+    return p ? p->mp_impl->get_thread_pool(thread_count) : nullptr;
+}
+
+}
+
 model_context::input_cell::input_cell(std::nullptr_t) : type(celltype_t::empty) {}
 model_context::input_cell::input_cell(bool b) : type(celltype_t::boolean)
 {
@@ -222,46 +232,27 @@ double model_context::count_range(const abs_range_t& range, const values_t& valu
 
 matrix model_context::get_range_value(const abs_range_t& range) const
 {
-    if (range.first.sheet != range.last.sheet)
-        throw general_error("multi-sheet range is not allowed.");
-
-    if (!range.valid())
-    {
-        std::ostringstream os;
-        os << "invalid range: " << range;
-        throw std::invalid_argument(os.str());
-    }
-
-    rc_size_t sheet_size = get_sheet_size();
-    abs_range_t range_clipped = range;
-    if (range_clipped.all_rows())
-    {
-        range_clipped.first.row = 0;
-        range_clipped.last.row = sheet_size.row - 1;
-    }
-    if (range_clipped.all_columns())
-    {
-        range_clipped.first.column = 0;
-        range_clipped.last.column = sheet_size.column - 1;
-    }
-
-    row_t rows = range_clipped.last.row - range_clipped.first.row + 1;
-    col_t cols = range_clipped.last.column - range_clipped.first.column + 1;
-
-    matrix ret(rows, cols);
-    for (row_t i = 0; i < rows; ++i)
-    {
-        for (col_t j = 0; j < cols; ++j)
-        {
-            row_t row = i + range_clipped.first.row;
-            col_t col = j + range_clipped.first.column;
-            double val = get_numeric_value(abs_address_t(range_clipped.first.sheet, row, col));
-
-            // TODO: we need to handle string types when that becomes available.
-            ret.set(i, j, val);
-        }
-    }
-    return ret;
+    return mp_impl->get_range_value(range);
+}
+
+void model_context::walk(sheet_t sheet, const abs_rc_range_t& range, column_block_callback_t cb) const
+{
+    mp_impl->walk(sheet, range, std::move(cb));
+}
+
+void model_context::fold_numeric(const abs_range_t& range, numeric_array_callback_t cb) const
+{
+    mp_impl->fold_numeric(range, std::move(cb));
+}
+
+void model_context::publish_formula_result(const abs_address_t& pos, const formula_cell& cell)
+{
+    mp_impl->publish_formula_result(pos, cell);
+}
+
+void model_context::reset_formula_result(const abs_address_t& pos)
+{
+    mp_impl->reset_formula_result(pos);
 }
 
 std::unique_ptr<iface::session_handler> model_context::create_session_handler()
@@ -19,9 +19,14 @@
 #include "utils.hpp"
 #include "debug.hpp"
 
+#if IXION_THREADS
+#include "thread_pool.hpp"
+#endif
+
 #include <sstream>
 #include <iostream>
 #include <cstring>
+#include <algorithm>
 
 using std::cout;
 using std::endl;
@@ -110,8 +115,6 @@ string_id_t safe_string_pool::get_identifier_from_string(std::string_view s) con
 
 namespace {
 
-model_context::session_handler_factory dummy_session_handler_factory;
-
 rc_size_t to_group_size(const abs_range_t& group_range)
 {
     rc_size_t group_size;
@@ -137,6 +140,8 @@ void set_grouped_formula_cells_to_workbook(
             row_t row = top_left.row + row_offset;
             pos_hint = col_store.set(pos_hint, row, new formula_cell(row_offset, col_offset, cs, ts));
         }
+
+        sheet.clear_results(col, top_left.row, top_left.row + group_size.row - 1);
     }
 }
 
@@ -188,7 +193,7 @@ model_context_impl::model_context_impl(model_context& parent, const rc_size_t& s
     m_sheet_size(sheet_size),
     m_tracker(),
     mp_table_handler(nullptr),
-    mp_session_factory(&dummy_session_handler_factory),
+    mp_session_factory(nullptr),
     m_formula_res_wait_policy(formula_result_wait_policy_t::throw_exception)
 {
 }
@@ -405,37 +410,107 @@ const column_stores_t* model_context_impl::get_columns(sheet_t sheet) const
 
 namespace {
 
+/**
+ * Scan a run of formula cells in a column.  Consecutive rows whose numeric
+ * results are stored in the result column are passed to the first callback
+ * as one array.  All other rows are passed to the second callback one at a
+ * time, along with the state of their results in the result column.
+ *
+ * @param rc result column of the column, or nullptr if there is none.
+ * @param row row of the first formula cell.
+ * @param pp pointer to the first formula cell.
+ * @param n number of formula cells.
+ * @param numeric_run callback taking the position of the first cell in the
+ *                    run, the pointer to the first value and the number of
+ *                    values.
+ * @param single callback taking the position of the cell, the cell itself
+ *               and the state of its result.
+ */
+template<typename NumericRunT, typename SingleT>
+void scan_formula_block(
+    const formula_result_column* rc, row_t row, formula_cell* const* pp, size_t n,
+    NumericRunT numeric_run, SingleT single)
+{
+    using state_t = formula_result_column::state_t;
+
+    size_t i = 0;
+    while (i < n)
+    {
+        state_t state = rc ? rc->get_state(row + i) : state_t::unknown;
+        if (state != state_t::numeric)
+        {
+            single(i, *pp[i], state);
+            ++i;
+            continue;
+        }
+
+        // The values are contiguous only within a chunk of the result
+        // column.
+        size_t end_max = std::min(n, i + formula_result_column::get_contiguous_size(row + i));
+
+        size_t end = i + 1;
+        while (end < end_max && rc->get_state(row + end) == state_t::numeric)
+            ++end;
+
+        numeric_run(i, rc->get_values(row + i), end - i);
+        i = end;
+    }
+}
+
 double count_formula_block(
-    formula_result_wait_policy_t wait_policy, const column_store_t::const_iterator& itb, size_t offset, size_t len, const values_t& vt)
+    formula_result_wait_policy_t wait_policy, const formula_result_column* rc, row_t row,
+    const mdds::mtv::base_element_block& blk, size_t offset, size_t len, const values_t& vt)
 {
+    using state_t = formula_result_column::state_t;
+
     double ret = 0.0;
 
-    // Inspect each formula cell individually.
-    formula_cell** pp = &formula_element_block::at(*itb->data, offset);
-    formula_cell** pp_end = pp + len;
-    for (; pp != pp_end; ++pp)
+    auto numeric_run = [&](size_t, const double*, size_t n)
+    {
+        if (vt.is_numeric())
+            ret += n;
+    };
+
+    // Cells whose results are not in the result column are inspected
+    // individually.  Only the types of their results are queried, so that
+    // the results don't get copied.
+    auto single = [&](size_t, const formula_cell& fc, state_t state)
     {
-        const formula_cell& fc = **pp;
-        formula_result res = fc.get_result_cache(wait_policy);
+        switch (state)
+        {
+            case state_t::string:
+                if (vt.is_string())
+                    ++ret;
+                return;
+            case state_t::error:
+                if (vt.is_error())
+                    ++ret;
+                return;
+            default:
+                ;
+        }
 
-        switch (res.get_type())
+        switch (fc.get_value_type(wait_policy))
         {
-            case formula_result::result_type::value:
+            case cell_value_t::numeric:
                 if (vt.is_numeric())
                     ++ret;
                 break;
-            case formula_result::result_type::string:
+            case cell_value_t::string:
                 if (vt.is_string())
                     ++ret;
                 break;
-            case formula_result::result_type::error:
-                // TODO : how do we handle error formula cells?
-                break;
-            case formula_result::result_type::matrix:
-                // TODO : ditto
+            case cell_value_t::error:
+                if (vt.is_error())
+                    ++ret;
                 break;
+            default:
+                ;
         }
-    }
+    };
+
+    const formula_cell* const* pp = &formula_element_block::at(blk, offset);
+    scan_formula_block(rc, row, const_cast<formula_cell* const*>(pp), len, numeric_run, single);
 
     return ret;
 }
@@ -452,77 +527,323 @@ double model_context_impl::count_range(const abs_range_t& range, const values_t&
     if (static_cast<size_t>(last_sheet) >= m_sheets.size())
         last_sheet = m_sheets.size() - 1;
 
-    for (sheet_t sheet = range.first.sheet; sheet <= last_sheet; ++sheet)
+    sheet_t sheet = range.first.sheet;
+
+    column_block_callback_t cb = [&](col_t col, row_t row1, row_t row2, const column_block_shape_t& node)
     {
-        const worksheet& ws = m_sheets.at(sheet);
-        for (col_t col = range.first.column; col <= range.last.column; ++col)
+        size_t len = row2 - row1 + 1;
+        bool match = false;
+
+        switch (node.type)
         {
-            const column_store_t& cs = ws.at(col);
-            row_t cur_row = range.first.row;
-            column_store_t::const_position_type pos = cs.position(cur_row);
-            column_store_t::const_iterator itb = pos.first; // block iterator
-            column_store_t::const_iterator itb_end = cs.end();
-            size_t offset = pos.second;
-            if (itb == itb_end)
-                continue;
-
-            bool cont = true;
-            while (cont)
+            case column_block_t::numeric:
+                match = values_type.is_numeric();
+                break;
+            case column_block_t::boolean:
+                match = values_type.is_boolean();
+                break;
+            case column_block_t::string:
+                match = values_type.is_string();
+                break;
+            case column_block_t::empty:
+                match = values_type.is_empty();
+                break;
+            case column_block_t::formula:
+            {
+                const auto& blk = *static_cast<const mdds::mtv::base_element_block*>(node.data);
+                const formula_result_column* rc = m_sheets[sheet].get_result_column(col);
+                ret += count_formula_block(
+                    m_formula_res_wait_policy, rc, row1, blk, node.offset, len, values_type);
+                break;
+            }
+            default:
             {
-                // remaining length of current block.
-                size_t len = itb->size - offset;
-                row_t last_row = cur_row + len - 1;
+                std::ostringstream os;
+                os << __FUNCTION__ << ": unhandled block type (" << int(node.type) << ")";
+                throw general_error(os.str());
+            }
+        }
+
+        if (match)
+            ret += len;
+
+        return true;
+    };
+
+    for (; sheet <= last_sheet; ++sheet)
+        walk(sheet, range, cb);
+
+    return ret;
+}
+
+matrix model_context_impl::get_range_value(const abs_range_t& range) const
+{
+    if (range.first.sheet != range.last.sheet)
+        throw general_error("multi-sheet range is not allowed.");
+
+    if (!range.valid())
+    {
+        std::ostringstream os;
+        os << "invalid range: " << range;
+        throw std::invalid_argument(os.str());
+    }
 
-                if (last_row >= range.last.row)
+    abs_range_t range_clipped = range;
+    if (range_clipped.all_rows())
+    {
+        range_clipped.first.row = 0;
+        range_clipped.last.row = m_sheet_size.row - 1;
+    }
+    if (range_clipped.all_columns())
+    {
+        range_clipped.first.column = 0;
+        range_clipped.last.column = m_sheet_size.column - 1;
+    }
+
+    row_t rows = range_clipped.last.row - range_clipped.first.row + 1;
+    col_t cols = range_clipped.last.column - range_clipped.first.column + 1;
+
+    matrix ret(rows, cols);
+    const worksheet& sh = m_sheets.at(range_clipped.first.sheet);
+
+    // Transfer the values one column block at a time.  The matrix is
+    // initially filled with empty elements, so the empty blocks can simply
+    // be skipped.
+    column_block_callback_t cb = [&](col_t col, row_t row1, row_t row2, const column_block_shape_t& node)
+    {
+        assert(row1 <= row2);
+
+        size_t mx_row = row1 - range_clipped.first.row;
+        size_t mx_col = col - range_clipped.first.column;
+        size_t n = row2 - row1 + 1;
+
+        const auto& blk = *static_cast<const mdds::mtv::base_element_block*>(node.data);
+
+        switch (node.type)
+        {
+            case column_block_t::numeric:
+            {
+                const double* p = &numeric_element_block::at(blk, node.offset);
+                ret.set(mx_row, mx_col, p, p + n);
+                break;
+            }
+            case column_block_t::boolean:
+            {
+                auto it = boolean_element_block::cbegin(blk);
+                std::advance(it, node.offset);
+                for (size_t i = 0; i < n; ++i, ++it)
+                    ret.set(mx_row + i, mx_col, bool(*it));
+                break;
+            }
+            case column_block_t::string:
+            {
+                auto it = string_element_block::cbegin(blk);
+                std::advance(it, node.offset);
+                for (size_t i = 0; i < n; ++i, ++it)
                 {
-                    last_row = range.last.row;
-                    len = last_row - cur_row + 1;
-                    cont = false;
+                    const std::string* p = get_string(*it);
+                    if (p)
+                        ret.set(mx_row + i, mx_col, *p);
                 }
+                break;
+            }
+            case column_block_t::formula:
+            {
+                auto numeric_run = [&](size_t i, const double* p, size_t len)
+                {
+                    ret.set(mx_row + i, mx_col, p, p + len);
+                };
 
-                bool match = false;
-
-                switch (itb->type)
+                auto single = [&](size_t i, const formula_cell& fc, formula_result_column::state_t)
                 {
-                    case element_type_numeric:
-                        match = values_type.is_numeric();
-                        break;
-                    case element_type_boolean:
-                        match = values_type.is_boolean();
-                        break;
-                    case element_type_string:
-                        match = values_type.is_string();
-                        break;
-                    case element_type_empty:
-                        match = values_type.is_empty();
-                        break;
-                    case element_type_formula:
-                        ret += count_formula_block(m_formula_res_wait_policy, itb, offset, len, values_type);
-                        break;
-                    default:
+                    formula_result res = fc.get_result_cache(m_formula_res_wait_policy);
+                    switch (res.get_type())
                     {
-                        std::ostringstream os;
-                        os << __FUNCTION__ << ": unhandled block type (" << itb->type << ")";
-                        throw general_error(os.str());
+                        case formula_result::result_type::value:
+                            ret.set(mx_row + i, mx_col, res.get_value());
+                            break;
+                        case formula_result::result_type::string:
+                            ret.set(mx_row + i, mx_col, res.get_string());
+                            break;
+                        case formula_result::result_type::error:
+                            throw formula_error(res.get_error());
+                        default:
+                            throw formula_error(formula_error_t::invalid_value_type);
                     }
-                }
+                };
 
-                if (match)
-                    ret += len;
-
-                // Move to the next block.
-                cur_row = last_row + 1;
-                ++itb;
-                offset = 0;
-                if (itb == itb_end)
-                    cont = false;
+                const formula_result_column* rc = sh.get_result_column(col);
+                formula_cell* const* pp = &formula_element_block::at(blk, node.offset);
+                scan_formula_block(rc, row1, pp, n, numeric_run, single);
+                break;
             }
+            default:
+                ;
         }
-    }
+
+        return true;
+    };
+
+    walk(range_clipped.first.sheet, range_clipped, cb);
 
     return ret;
 }
 
+void model_context_impl::walk(sheet_t sheet, const abs_rc_range_t& range, column_block_callback_t cb) const
+{
+    if (!range.valid())
+        throw std::invalid_argument("invalid range.");
+
+    const worksheet& sh = m_sheets.at(sheet);
+
+    col_t col_first = range.first.column, col_last = range.last.column;
+    if (range.all_columns())
+    {
+        col_first = 0;
+        col_last = m_sheet_size.column - 1;
+    }
+
+    row_t row_first = range.first.row, row_last = range.last.row;
+    if (range.all_rows())
+    {
+        row_first = 0;
+        row_last = m_sheet_size.row - 1;
+    }
+
+    col_last = std::min<col_t>(col_last, sh.size() - 1);
+
+    for (col_t col = col_first; col <= col_last; ++col)
+    {
+        const column_store_t& col_store = sh.at(col);
+        if (col_store.empty())
+            continue;
+
+        row_t row_end = std::min<row_t>(row_last, col_store.size() - 1);
+        if (row_first > row_end)
+            continue;
+
+        column_store_t::const_position_type pos = col_store.position(row_first);
+        column_store_t::const_iterator itb = pos.first;
+        size_t offset = pos.second;
+        row_t row = row_first;
+
+        for (; itb != col_store.cend() && row <= row_end; ++itb, offset = 0)
+        {
+            // Last row of the current block that falls within the range.
+            row_t block_end = std::min<row_t>(itb->position + itb->size - 1, row_end);
+
+            column_block_shape_t shape(
+                itb->position, itb->size, offset, to_column_block_type(itb->type), itb->data);
+
+            if (!cb(col, row, block_end, shape))
+                return;
+
+            row = block_end + 1;
+        }
+    }
+}
+
+void model_context_impl::fold_numeric(const abs_range_t& range, numeric_array_callback_t cb) const
+{
+    if (!range.valid())
+    {
+        std::ostringstream os;
+        os << "invalid range: " << range;
+        throw std::invalid_argument(os.str());
+    }
+
+    // Boolean values and formula results are not stored as numeric arrays,
+    // so they get collected into this buffer before being passed.
+    constexpr size_t buf_capacity = 64;
+    double buf[buf_capacity];
+    size_t buf_size = 0;
+
+    auto flush = [&]()
+    {
+        if (buf_size)
+        {
+            cb(buf, buf_size);
+            buf_size = 0;
+        }
+    };
+
+    auto push = [&](double v)
+    {
+        buf[buf_size++] = v;
+        if (buf_size == buf_capacity)
+            flush();
+    };
+
+    sheet_t sheet = range.first.sheet;
+
+    column_block_callback_t walk_cb = [&](col_t col, row_t row1, row_t row2, const column_block_shape_t& node)
+    {
+        size_t n = row2 - row1 + 1;
+        const auto& blk = *static_cast<const mdds::mtv::base_element_block*>(node.data);
+
+        switch (node.type)
+        {
+            case column_block_t::numeric:
+            {
+                // Pass the values in the order they are stored.
+                flush();
+                cb(&numeric_element_block::at(blk, node.offset), n);
+                break;
+            }
+            case column_block_t::boolean:
+            {
+                auto it = boolean_element_block::cbegin(blk);
+                std::advance(it, node.offset);
+                for (size_t i = 0; i < n; ++i, ++it)
+                    push(*it ? 1.0 : 0.0);
+                break;
+            }
+            case column_block_t::formula:
+            {
+                // Numeric results stored in the result column are passed
+                // directly, as with the numeric cells.
+                auto numeric_run = [&](size_t, const double* p, size_t len)
+                {
+                    flush();
+                    cb(p, len);
+                };
+
+                auto single = [&](size_t, const formula_cell& fc, formula_result_column::state_t state)
+                {
+                    if (state == formula_result_column::state_t::string)
+                        return;
+
+                    formula_result res = fc.get_result_cache(m_formula_res_wait_policy);
+                    switch (res.get_type())
+                    {
+                        case formula_result::result_type::value:
+                            push(res.get_value());
+                            break;
+                        case formula_result::result_type::error:
+                            throw formula_error(res.get_error());
+                        default:
+                            ;
+                    }
+                };
+
+                const formula_result_column* rc = m_sheets[sheet].get_result_column(col);
+                formula_cell* const* pp = &formula_element_block::at(blk, node.offset);
+                scan_formula_block(rc, row1, pp, n, numeric_run, single);
+                break;
+            }
+            default:
+                ;
+        }
+
+        return true;
+    };
+
+    for (; sheet <= range.last.sheet; ++sheet)
+        walk(sheet, range, walk_cb);
+
+    flush();
+}
+
 bool model_context_impl::empty() const
 {
     return m_sheets.empty();
@@ -571,15 +892,37 @@ void model_context_impl::set_sheet_size(const rc_size_t& sheet_size)
 
 std::unique_ptr<iface::session_handler> model_context_impl::create_session_handler()
 {
+    if (!mp_session_factory)
+        // No listener is registered.  Skip the virtual call.
+        return std::unique_ptr<iface::session_handler>();
+
     return mp_session_factory->create();
 }
 
+thread_pool* model_context_impl::get_thread_pool(size_t thread_count)
+{
+#if IXION_THREADS
+    if (!thread_count)
+        return nullptr;
+
+    // Re-create the pool only when the requested thread count changes.
+    if (!mp_thread_pool || mp_thread_pool->size() != thread_count)
+        mp_thread_pool = std::make_unique<thread_pool>(thread_count);
+
+    return mp_thread_pool.get();
+#else
+    (void)thread_count;
+    return nullptr;
+#endif
+}
+
 void model_context_impl::empty_cell(const abs_address_t& addr)
 {
     worksheet& sheet = m_sheets.at(addr.sheet);
     column_store_t& col_store = sheet.at(addr.column);
     column_store_t::iterator& pos_hint = sheet.get_pos_hint(addr.column);
     pos_hint = col_store.set_empty(addr.row, addr.row);
+    sheet.clear_results(addr.column, addr.row, addr.row);
 }
 
 void model_context_impl::set_numeric_cell(const abs_address_t& addr, double val)
@@ -588,6 +931,7 @@ void model_context_impl::set_numeric_cell(const abs_address_t& addr, double val)
     column_store_t& col_store = sheet.at(addr.column);
     column_store_t::iterator& pos_hint = sheet.get_pos_hint(addr.column);
     pos_hint = col_store.set(pos_hint, addr.row, val);
+    sheet.clear_results(addr.column, addr.row, addr.row);
 }
 
 void model_context_impl::set_boolean_cell(const abs_address_t& addr, bool val)
@@ -596,6 +940,7 @@ void model_context_impl::set_boolean_cell(const abs_address_t& addr, bool val)
     column_store_t& col_store = sheet.at(addr.column);
     column_store_t::iterator& pos_hint = sheet.get_pos_hint(addr.column);
     pos_hint = col_store.set(pos_hint, addr.row, val);
+    sheet.clear_results(addr.column, addr.row, addr.row);
 }
 
 void model_context_impl::set_string_cell(const abs_address_t& addr, std::string_view s)
@@ -605,6 +950,7 @@ void model_context_impl::set_string_cell(const abs_address_t& addr, std::string_
     column_store_t& col_store = sheet.at(addr.column);
     column_store_t::iterator& pos_hint = sheet.get_pos_hint(addr.column);
     pos_hint = col_store.set(pos_hint, addr.row, str_id);
+    sheet.clear_results(addr.column, addr.row, addr.row);
 }
 
 void model_context_impl::fill_down_cells(const abs_address_t& src, size_t n_dst)
@@ -616,6 +962,7 @@ void model_context_impl::fill_down_cells(const abs_address_t& src, size_t n_dst)
     worksheet& sheet = m_sheets.at(src.sheet);
     column_store_t& col_store = sheet.at(src.column);
     column_store_t::iterator& pos_hint = sheet.get_pos_hint(src.column);
+    sheet.clear_results(src.column, src.row + 1, src.row + n_dst);
 
     column_store_t::const_position_type pos = col_store.position(pos_hint, src.row);
     auto it = pos.first; // block iterator
@@ -668,6 +1015,7 @@ void model_context_impl::set_string_cell(const abs_address_t& addr, string_id_t
     column_store_t& col_store = sheet.at(addr.column);
     column_store_t::iterator& pos_hint = sheet.get_pos_hint(addr.column);
     pos_hint = col_store.set(pos_hint, addr.row, identifier);
+    sheet.clear_results(addr.column, addr.row, addr.row);
 }
 
 formula_cell* model_context_impl::set_formula_cell(
@@ -680,6 +1028,7 @@ formula_cell* model_context_impl::set_formula_cell(
     column_store_t::iterator& pos_hint = sheet.get_pos_hint(addr.column);
     formula_cell* p = fcell.release();
     pos_hint = col_store.set(pos_hint, addr.row, p);
+    sheet.clear_results(addr.column, addr.row, addr.row);
     return p;
 }
 
@@ -694,6 +1043,7 @@ formula_cell* model_context_impl::set_formula_cell(
     formula_cell* p = fcell.release();
     p->set_result_cache(std::move(result));
     pos_hint = col_store.set(pos_hint, addr.row, p);
+    sheet.clear_results(addr.column, addr.row, addr.row);
     return p;
 }
 
@@ -723,7 +1073,8 @@ void model_context_impl::set_grouped_formula_cells(
         throw std::invalid_argument("dimension of the cached result differs from the size of the group.");
 
     calc_status_ptr_t cs(new calc_status(group_size));
-    cs->result = std::make_unique<formula_result>(std::move(result));
+    cs->result = std::move(result);
+    cs->publish_result();
     set_grouped_formula_cells_to_workbook(m_sheets, group_range.first, group_size, cs, ts);
 }
 
@@ -968,6 +1319,104 @@ formula_result model_context_impl::get_formula_result(const abs_address_t& addr)
     return fc->get_result_cache(m_formula_res_wait_policy);
 }
 
+namespace {
+
+void publish_formula_result_to_column(formula_result_column& rc, row_t row, const formula_cell& cell)
+{
+    using state_t = formula_result_column::state_t;
+
+    // Only the rows that have been reset before the calculation are
+    // covered.  No storage gets allocated here, as this may get called from
+    // worker threads.
+    if (rc.get_state(row) == state_t::absent)
+        return;
+
+    switch (cell.get_value_type(formula_result_wait_policy_t::throw_exception))
+    {
+        case cell_value_t::numeric:
+            rc.set_numeric(row, cell.get_value(formula_result_wait_policy_t::throw_exception));
+            break;
+        case cell_value_t::string:
+            rc.set_state(row, state_t::string);
+            break;
+        case cell_value_t::error:
+            rc.set_state(row, state_t::error);
+            break;
+        default:
+            ;
+    }
+}
+
+}
+
+void model_context_impl::publish_formula_result(const abs_address_t& pos, const formula_cell& cell)
+{
+    if (pos.sheet < 0 || size_t(pos.sheet) >= m_sheets.size())
+        return;
+
+    worksheet& sheet = m_sheets[pos.sheet];
+
+    formula_group_t group = cell.get_group_properties();
+    if (!group.grouped)
+    {
+        formula_result_column* rc = sheet.get_result_column(pos.column);
+        if (rc)
+            publish_formula_result_to_column(*rc, pos.row, cell);
+
+        return;
+    }
+
+    // A grouped formula gets calculated only once for all of its cells.
+    // Publish the result of each cell in the group.
+    abs_address_t origin = cell.get_parent_position(pos);
+
+    for (col_t col = 0; col < group.size.column; ++col)
+    {
+        formula_result_column* rc = sheet.get_result_column(origin.column + col);
+        if (!rc)
+            continue;
+
+        for (row_t row = 0; row < group.size.row; ++row)
+        {
+            abs_address_t addr(pos.sheet, origin.row + row, origin.column + col);
+            const formula_cell* member = get_formula_cell(addr);
+
+            // Skip the cells that have been overwritten since the group got
+            // inserted.
+            if (member && member->get_group_properties().identity == group.identity)
+                publish_formula_result_to_column(*rc, addr.row, *member);
+        }
+    }
+}
+
+void model_context_impl::reset_formula_result(const abs_address_t& pos)
+{
+    worksheet& sheet = m_sheets.at(pos.sheet);
+
+    const formula_cell* cell = get_formula_cell(pos);
+    formula_group_t group = cell ? cell->get_group_properties() : formula_group_t();
+    if (!group.grouped)
+    {
+        sheet.fetch_result_column(pos.column).clear(pos.row);
+        return;
+    }
+
+    abs_address_t origin = cell->get_parent_position(pos);
+
+    for (col_t col = 0; col < group.size.column; ++col)
+    {
+        formula_result_column& rc = sheet.fetch_result_column(origin.column + col);
+
+        for (row_t row = 0; row < group.size.row; ++row)
+        {
+            abs_address_t addr(pos.sheet, origin.row + row, origin.column + col);
+            const formula_cell* member = get_formula_cell(addr);
+            if (member && member->get_group_properties().identity == group.identity)
+                rc.clear(addr.row);
+        }
+    }
+}
+
 }}
 
 /* vim:set shiftwidth=4 softtabstop=4 expandtab: */
@@ -22,7 +22,11 @@
 #include <unordered_map>
 #include <mutex>
 
-namespace ixion { namespace detail {
+namespace ixion {
+
+class thread_pool;
+
+namespace detail {
 
 class safe_string_pool
 {
@@ -109,6 +113,8 @@ public:
         mp_table_handler = handler;
     }
 
+    thread_pool* get_thread_pool(size_t thread_count);
+
     void empty_cell(const abs_address_t& addr);
     void set_numeric_cell(const abs_address_t& addr, double val);
     void set_boolean_cell(const abs_address_t& addr, bool val);
@@ -159,6 +165,14 @@ public:
 
     double count_range(const abs_range_t& range, const values_t& values_type) const;
 
+    matrix get_range_value(const abs_range_t& range) const;
+
+    void walk(sheet_t sheet, const abs_rc_range_t& range, column_block_callback_t cb) const;
+
+    void fold_numeric(const abs_range_t& range, numeric_array_callback_t cb) const;
+    void publish_formula_result(const abs_address_t& pos, const formula_cell& cell);
+    void reset_formula_result(const abs_address_t& pos);
+
     bool empty() const;
 
     const worksheet* fetch_sheet(sheet_t sheet_index) const;
@@ -189,6 +203,31 @@ private:
     safe_string_pool m_str_pool;
 
     formula_result_wait_policy_t m_formula_res_wait_policy;
+
+#if IXION_THREADS
+    std::unique_ptr<thread_pool> mp_thread_pool;
+#endif
+};
+
+/**
+ * Provides access to the pool of worker threads owned by a model context,
+ * which is reused across calculation runs so that the worker threads don't
+ * have to be launched each time.
+ */
+class model_thread_pool
+{
+public:
+    /**
+     * Get the thread pool owned by a model.
+     *
+     * @param cxt model to get the thread pool of.
+     * @param thread_count number of worker threads the pool should have.
+     *
+     * @return pointer to the thread pool owned by the model, or nullptr if
+     *         the model is not a model_context.  The caller should then
+     *         create a temporary pool for the duration of its run.
+     */
+    static thread_pool* get(iface::formula_model_access& cxt, size_t thread_count);
 };
 
 }}
@@ -0,0 +1,415 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "numeric_kernels.hpp"
+
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define IXION_KERNELS_X86 1
+#define IXION_KERNELS_TARGET_SSE2 __attribute__((target("sse2")))
+#define IXION_KERNELS_TARGET_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#elif defined(_MSC_VER) && defined(_M_X64)
+// SSE2 is always available on x86-64.  The AVX2 kernels are only used with
+// GCC or clang, which can compile them without enabling AVX2 for the whole
+// translation unit.
+#define IXION_KERNELS_X86 1
+#define IXION_KERNELS_TARGET_SSE2
+#include <immintrin.h>
+#else
+#define IXION_KERNELS_X86 0
+#endif
+
+namespace ixion {
+
+namespace {
+
+/**
+ * Number of values in each leaf block of the pairwise summation.  It must
+ * be a multiple of 4.
+ */
+constexpr size_t sum_leaf_size = 256;
+
+constexpr double nan = std::numeric_limits<double>::quiet_NaN();
+
+using sum_leaf_func_t = double (*)(const double*, size_t);
+using minmax_func_t = double (*)(const double*, size_t);
+
+struct kernel_table
+{
+    sum_leaf_func_t sum_leaf;
+    minmax_func_t min;
+    minmax_func_t max;
+};
+
+/**
+ * Reference implementation of the leaf block summation.  The values are
+ * added to four partial sums in a round-robin fashion, the partial sums are
+ * combined pairwise, and the remaining values are added at the end.  All
+ * other implementations must add the values in exactly the same order.
+ */
+double sum_leaf_scalar(const double* p, size_t n)
+{
+    double acc[4] = { 0.0, 0.0, 0.0, 0.0 };
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        acc[0] += p[i];
+        acc[1] += p[i+1];
+        acc[2] += p[i+2];
+        acc[3] += p[i+3];
+    }
+
+    double sum = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+    for (; i < n; ++i)
+        sum += p[i];
+
+    return sum;
+}
+
+/**
+ * Reference implementation of finding the smallest value.  A NaN anywhere
+ * in the array makes the result NaN.  All other implementations must
+ * handle NaN in the same way.
+ */
+double min_scalar(const double* p, size_t n)
+{
+    double ret = p[0];
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (std::isnan(p[i]))
+            return nan;
+
+        if (p[i] < ret)
+            ret = p[i];
+    }
+
+    return ret;
+}
+
+double max_scalar(const double* p, size_t n)
+{
+    double ret = p[0];
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (std::isnan(p[i]))
+            return nan;
+
+        if (p[i] > ret)
+            ret = p[i];
+    }
+
+    return ret;
+}
+
+#if IXION_KERNELS_X86
+
+IXION_KERNELS_TARGET_SSE2
+double sum_leaf_sse2(const double* p, size_t n)
+{
+    // Two registers hold the four partial sums.
+    __m128d acc01 = _mm_setzero_pd();
+    __m128d acc23 = _mm_setzero_pd();
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        acc01 = _mm_add_pd(acc01, _mm_loadu_pd(p + i));
+        acc23 = _mm_add_pd(acc23, _mm_loadu_pd(p + i + 2));
+    }
+
+    double acc[4];
+    _mm_storeu_pd(acc, acc01);
+    _mm_storeu_pd(acc + 2, acc23);
+
+    double sum = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+    for (; i < n; ++i)
+        sum += p[i];
+
+    return sum;
+}
+
+IXION_KERNELS_TARGET_SSE2
+double min_sse2(const double* p, size_t n)
+{
+    if (n < 2)
+        return p[0];
+
+    // _mm_min_pd() does not propagate NaN from its first operand, so the
+    // NaN values are tracked separately.
+    __m128d v = _mm_loadu_pd(p);
+    __m128d unord = _mm_cmpunord_pd(v, v);
+
+    size_t i = 2;
+    for (; i + 2 <= n; i += 2)
+    {
+        __m128d x = _mm_loadu_pd(p + i);
+        unord = _mm_or_pd(unord, _mm_cmpunord_pd(x, x));
+        v = _mm_min_pd(v, x);
+    }
+
+    if (_mm_movemask_pd(unord))
+        return nan;
+
+    double buf[2];
+    _mm_storeu_pd(buf, v);
+
+    double ret = buf[0] < buf[1] ? buf[0] : buf[1];
+    for (; i < n; ++i)
+    {
+        if (std::isnan(p[i]))
+            return nan;
+
+        if (p[i] < ret)
+            ret = p[i];
+    }
+
+    return ret;
+}
+
+IXION_KERNELS_TARGET_SSE2
+double max_sse2(const double* p, size_t n)
+{
+    if (n < 2)
+        return p[0];
+
+    __m128d v = _mm_loadu_pd(p);
+    __m128d unord = _mm_cmpunord_pd(v, v);
+
+    size_t i = 2;
+    for (; i + 2 <= n; i += 2)
+    {
+        __m128d x = _mm_loadu_pd(p + i);
+        unord = _mm_or_pd(unord, _mm_cmpunord_pd(x, x));
+        v = _mm_max_pd(v, x);
+    }
+
+    if (_mm_movemask_pd(unord))
+        return nan;
+
+    double buf[2];
+    _mm_storeu_pd(buf, v);
+
+    double ret = buf[0] > buf[1] ? buf[0] : buf[1];
+    for (; i < n; ++i)
+    {
+        if (std::isnan(p[i]))
+            return nan;
+
+        if (p[i] > ret)
+            ret = p[i];
+    }
+
+    return ret;
+}
+
+#ifdef IXION_KERNELS_TARGET_AVX2
+
+IXION_KERNELS_TARGET_AVX2
+double sum_leaf_avx2(const double* p, size_t n)
+{
+    // One register holds all four partial sums.
+    __m256d acc4 = _mm256_setzero_pd();
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        acc4 = _mm256_add_pd(acc4, _mm256_loadu_pd(p + i));
+
+    double acc[4];
+    _mm256_storeu_pd(acc, acc4);
+
+    double sum = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+    for (; i < n; ++i)
+        sum += p[i];
+
+    return sum;
+}
+
+IXION_KERNELS_TARGET_AVX2
+double min_avx2(const double* p, size_t n)
+{
+    if (n < 8)
+        return min_scalar(p, n);
+
+    __m256d v0 = _mm256_loadu_pd(p);
+    __m256d v1 = _mm256_loadu_pd(p + 4);
+    __m256d unord = _mm256_or_pd(
+        _mm256_cmp_pd(v0, v0, _CMP_UNORD_Q), _mm256_cmp_pd(v1, v1, _CMP_UNORD_Q));
+
+    size_t i = 8;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256d x0 = _mm256_loadu_pd(p + i);
+        __m256d x1 = _mm256_loadu_pd(p + i + 4);
+        unord = _mm256_or_pd(unord, _mm256_or_pd(
+            _mm256_cmp_pd(x0, x0, _CMP_UNORD_Q), _mm256_cmp_pd(x1, x1, _CMP_UNORD_Q)));
+        v0 = _mm256_min_pd(v0, x0);
+        v1 = _mm256_min_pd(v1, x1);
+    }
+
+    if (_mm256_movemask_pd(unord))
+        return nan;
+
+    double buf[4];
+    _mm256_storeu_pd(buf, _mm256_min_pd(v0, v1));
+
+    double ret = min_scalar(buf, 4);
+    for (; i < n; ++i)
+    {
+        if (std::isnan(p[i]))
+            return nan;
+
+        if (p[i] < ret)
+            ret = p[i];
+    }
+
+    return ret;
+}
+
+IXION_KERNELS_TARGET_AVX2
+double max_avx2(const double* p, size_t n)
+{
+    if (n < 8)
+        return max_scalar(p, n);
+
+    __m256d v0 = _mm256_loadu_pd(p);
+    __m256d v1 = _mm256_loadu_pd(p + 4);
+    __m256d unord = _mm256_or_pd(
+        _mm256_cmp_pd(v0, v0, _CMP_UNORD_Q), _mm256_cmp_pd(v1, v1, _CMP_UNORD_Q));
+
+    size_t i = 8;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256d x0 = _mm256_loadu_pd(p + i);
+        __m256d x1 = _mm256_loadu_pd(p + i + 4);
+        unord = _mm256_or_pd(unord, _mm256_or_pd(
+            _mm256_cmp_pd(x0, x0, _CMP_UNORD_Q), _mm256_cmp_pd(x1, x1, _CMP_UNORD_Q)));
+        v0 = _mm256_max_pd(v0, x0);
+        v1 = _mm256_max_pd(v1, x1);
+    }
+
+    if (_mm256_movemask_pd(unord))
+        return nan;
+
+    double buf[4];
+    _mm256_storeu_pd(buf, _mm256_max_pd(v0, v1));
+
+    double ret = max_scalar(buf, 4);
+    for (; i < n; ++i)
+    {
+        if (std::isnan(p[i]))
+            return nan;
+
+        if (p[i] > ret)
+            ret = p[i];
+    }
+
+    return ret;
+}
+
+#endif // IXION_KERNELS_TARGET_AVX2
+
+#endif // IXION_KERNELS_X86
+
+kernel_table select_kernels()
+{
+#if IXION_KERNELS_X86
+#ifdef IXION_KERNELS_TARGET_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return { sum_leaf_avx2, min_avx2, max_avx2 };
+#if defined(__i386__)
+    if (!__builtin_cpu_supports("sse2"))
+        return { sum_leaf_scalar, min_scalar, max_scalar };
+#endif
+#endif
+    return { sum_leaf_sse2, min_sse2, max_sse2 };
+#else
+    return { sum_leaf_scalar, min_scalar, max_scalar };
+#endif
+}
+
+const kernel_table& get_kernels()
+{
+    static const kernel_table table = select_kernels();
+    return table;
+}
+
+double sum_pairwise(sum_leaf_func_t sum_leaf, const double* p, size_t n)
+{
+    if (n <= sum_leaf_size)
+        return sum_leaf(p, n);
+
+    // Split at a leaf block boundary so that the leaf blocks stay aligned
+    // to the start of the array.
+    size_t half = (n / 2 + sum_leaf_size - 1) / sum_leaf_size * sum_leaf_size;
+    return sum_pairwise(sum_leaf, p, half) + sum_pairwise(sum_leaf, p + half, n - half);
+}
+
+} // anonymous namespace
+
+double sum_values(const double* p, size_t n)
+{
+    if (!n)
+        return 0.0;
+
+    return sum_pairwise(get_kernels().sum_leaf, p, n);
+}
+
+double min_value(const double* p, size_t n)
+{
+    assert(n > 0);
+    return get_kernels().min(p, n);
+}
+
+double max_value(const double* p, size_t n)
+{
+    assert(n > 0);
+    return get_kernels().max(p, n);
+}
+
+sum_accumulator::sum_accumulator() : m_sum(0.0), m_compensation(0.0) {}
+
+void sum_accumulator::add(double v)
+{
+    double t = m_sum + v;
+
+    if (!std::isfinite(t))
+    {
+        // The compensation would compute inf - inf, which is NaN.  The sum
+        // stays infinite or NaN from here on regardless of the compensation.
+        m_sum = t;
+        return;
+    }
+
+    // Recover the low-order bits lost in the addition above.
+    if (std::fabs(m_sum) >= std::fabs(v))
+        m_compensation += (m_sum - t) + v;
+    else
+        m_compensation += (v - t) + m_sum;
+
+    m_sum = t;
+}
+
+void sum_accumulator::add(const double* p, size_t n)
+{
+    if (n)
+        add(sum_values(p, n));
+}
+
+double sum_accumulator::get() const
+{
+    return m_sum + m_compensation;
+}
+
+}
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
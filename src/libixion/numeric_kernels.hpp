@@ -0,0 +1,75 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef INCLUDED_IXION_NUMERIC_KERNELS_HPP
+#define INCLUDED_IXION_NUMERIC_KERNELS_HPP
+
+#include <cstdlib>
+
+namespace ixion {
+
+/**
+ * Sum a contiguous array of numeric values.  The values are summed pairwise
+ * down to fixed-size leaf blocks, and each leaf block is summed using four
+ * interleaved partial sums.  The implementation that runs is selected at
+ * run time based on the instruction sets supported by the CPU, but the
+ * order of additions is the same in all implementations, hence the result
+ * is always the same for the same input.
+ *
+ * @param p pointer to the first value.
+ * @param n number of values.
+ *
+ * @return sum of the values, or 0 if the array is empty.
+ */
+double sum_values(const double* p, size_t n);
+
+/**
+ * Find the smallest value in a contiguous array of numeric values.
+ *
+ * @param p pointer to the first value.
+ * @param n number of values.  It must be greater than 0.
+ *
+ * @return smallest value in the array, or NaN if the array contains a NaN.
+ */
+double min_value(const double* p, size_t n);
+
+/**
+ * Find the largest value in a contiguous array of numeric values.
+ *
+ * @param p pointer to the first value.
+ * @param n number of values.  It must be greater than 0.
+ *
+ * @return largest value in the array, or NaN if the array contains a NaN.
+ */
+double max_value(const double* p, size_t n);
+
+/**
+ * Accumulate numeric values and arrays of numeric values into a single
+ * sum.  Each array is summed with sum_values(), and the partial sums are
+ * added using Neumaier's variant of Kahan summation, so that the rounding
+ * error does not grow with the number of partial sums.  Once the sum
+ * becomes infinite or NaN, it stays that way.
+ */
+class sum_accumulator
+{
+    double m_sum;
+    double m_compensation;
+
+public:
+    sum_accumulator();
+
+    void add(double v);
+    void add(const double* p, size_t n);
+
+    double get() const;
+};
+
+}
+
+#endif
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
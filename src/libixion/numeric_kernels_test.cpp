@@ -0,0 +1,247 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "numeric_kernels.hpp"
+
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <iostream>
+
+using namespace ixion;
+using namespace std;
+
+namespace {
+
+constexpr double qnan = std::numeric_limits<double>::quiet_NaN();
+constexpr double inf = std::numeric_limits<double>::infinity();
+
+/**
+ * Lengths to test with.  They cover the remainders left by the vector
+ * loops, and the boundaries of the leaf blocks of the pairwise summation.
+ */
+const size_t lengths[] = {
+    1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 255, 256, 257, 511, 513, 1001
+};
+
+/**
+ * Create an array of small integers, whose sum is exact regardless of the
+ * order of additions.
+ */
+std::vector<double> create_values(size_t n)
+{
+    std::vector<double> values;
+    for (size_t i = 0; i < n; ++i)
+        values.push_back(double(i % 7) - 3.0);
+
+    return values;
+}
+
+double sum_exact(const std::vector<double>& values)
+{
+    double sum = 0.0;
+    for (double v : values)
+        sum += v;
+
+    return sum;
+}
+
+}
+
+void test_sum_values()
+{
+    cout << "--" << endl << __FUNCTION__ << endl;
+
+    assert(sum_values(nullptr, 0) == 0.0);
+
+    for (size_t n : lengths)
+    {
+        std::vector<double> values = create_values(n);
+        assert(sum_values(values.data(), n) == sum_exact(values));
+
+        // Sum a sub-array that does not start at a vector boundary.
+        if (n > 1)
+        {
+            std::vector<double> tail(values.begin() + 1, values.end());
+            assert(sum_values(values.data() + 1, n - 1) == sum_exact(tail));
+        }
+    }
+}
+
+void test_sum_values_nan_inf()
+{
+    cout << "--" << endl << __FUNCTION__ << endl;
+
+    for (size_t n : lengths)
+    {
+        for (size_t pos : { size_t(0), n / 2, n - 1 })
+        {
+            std::vector<double> values = create_values(n);
+            values[pos] = qnan;
+            assert(std::isnan(sum_values(values.data(), n)));
+
+            values[pos] = inf;
+            assert(sum_values(values.data(), n) == inf);
+
+            values[pos] = -inf;
+            assert(sum_values(values.data(), n) == -inf);
+        }
+
+        if (n > 1)
+        {
+            std::vector<double> values = create_values(n);
+            values[0] = inf;
+            values[n - 1] = -inf;
+            assert(std::isnan(sum_values(values.data(), n)));
+        }
+    }
+}
+
+void test_min_max_values()
+{
+    cout << "--" << endl << __FUNCTION__ << endl;
+
+    for (size_t n : lengths)
+    {
+        // Place the smallest and the largest values at every position.
+        for (size_t pos = 0; pos < n; ++pos)
+        {
+            std::vector<double> values = create_values(n);
+
+            values[pos] = -10.0;
+            assert(min_value(values.data(), n) == -10.0);
+
+            values[pos] = 10.0;
+            assert(max_value(values.data(), n) == 10.0);
+
+            values[pos] = -inf;
+            assert(min_value(values.data(), n) == -inf);
+
+            values[pos] = inf;
+            assert(max_value(values.data(), n) == inf);
+        }
+    }
+
+    double v = 2.5;
+    assert(min_value(&v, 1) == 2.5);
+    assert(max_value(&v, 1) == 2.5);
+}
+
+void test_min_max_values_nan()
+{
+    cout << "--" << endl << __FUNCTION__ << endl;
+
+    for (size_t n : lengths)
+    {
+        // A NaN at any position makes the result NaN.
+        for (size_t pos = 0; pos < n; ++pos)
+        {
+            std::vector<double> values = create_values(n);
+            values[pos] = qnan;
+            assert(std::isnan(min_value(values.data(), n)));
+            assert(std::isnan(max_value(values.data(), n)));
+        }
+    }
+}
+
+void test_sum_accumulator()
+{
+    cout << "--" << endl << __FUNCTION__ << endl;
+
+    {
+        sum_accumulator acc;
+        assert(acc.get() == 0.0);
+    }
+
+    {
+        // The compensation recovers the value lost when adding it to a much
+        // larger value.
+        sum_accumulator acc;
+        acc.add(1e100);
+        acc.add(1.0);
+        acc.add(-1e100);
+        assert(acc.get() == 1.0);
+    }
+
+    {
+        sum_accumulator acc;
+        for (size_t n : lengths)
+        {
+            std::vector<double> values = create_values(n);
+            acc.add(values.data(), values.size());
+        }
+
+        double expected = 0.0;
+        for (size_t n : lengths)
+            expected += sum_exact(create_values(n));
+
+        assert(acc.get() == expected);
+
+        acc.add(nullptr, 0);
+        assert(acc.get() == expected);
+    }
+}
+
+void test_sum_accumulator_nan_inf()
+{
+    cout << "--" << endl << __FUNCTION__ << endl;
+
+    {
+        sum_accumulator acc;
+        acc.add(1.0);
+        acc.add(inf);
+        assert(acc.get() == inf);
+        acc.add(1.0);
+        assert(acc.get() == inf);
+    }
+
+    {
+        sum_accumulator acc;
+        acc.add(-inf);
+        acc.add(1.0);
+        assert(acc.get() == -inf);
+    }
+
+    {
+        // Overflowing the range of double yields infinity.
+        double max = std::numeric_limits<double>::max();
+        sum_accumulator acc;
+        acc.add(max);
+        acc.add(max);
+        assert(acc.get() == inf);
+    }
+
+    {
+        sum_accumulator acc;
+        acc.add(inf);
+        acc.add(-inf);
+        assert(std::isnan(acc.get()));
+    }
+
+    {
+        sum_accumulator acc;
+        acc.add(1.0);
+        acc.add(qnan);
+        acc.add(1.0);
+        assert(std::isnan(acc.get()));
+    }
+}
+
+int main()
+{
+    test_sum_values();
+    test_sum_values_nan_inf();
+    test_min_max_values();
+    test_min_max_values_nan();
+    test_sum_accumulator();
+    test_sum_accumulator_nan_inf();
+
+    return EXIT_SUCCESS;
+}
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
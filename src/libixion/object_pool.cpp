@@ -0,0 +1,179 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "object_pool.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+namespace ixion {
+
+namespace {
+
+/**
+ * Size of each slab.  Slabs are aligned to their size, so that the slab
+ * which an object belongs to can be found from the address of the object.
+ */
+constexpr size_t slab_size = 64 * 1024;
+
+constexpr size_t object_alignment = alignof(std::max_align_t);
+
+size_t round_up(size_t n, size_t unit)
+{
+    return (n + unit - 1) / unit * unit;
+}
+
+}
+
+struct object_pool::slab
+{
+    slab* prev;
+    slab* next;
+
+    /** Singly linked list of freed slots. */
+    void* free_slots;
+
+    /** Number of slots in use. */
+    size_t used;
+
+    /** Number of slots that have been handed out at least once. */
+    size_t touched;
+
+    char* get_slot(size_t pos, size_t object_size)
+    {
+        char* p = reinterpret_cast<char*>(this) + round_up(sizeof(slab), object_alignment);
+        return p + pos * object_size;
+    }
+};
+
+object_pool::object_pool(size_t object_size) :
+    m_object_size(round_up(std::max(object_size, sizeof(void*)), object_alignment)),
+    m_slab_capacity((slab_size - round_up(sizeof(slab), object_alignment)) / m_object_size),
+    mp_free_slabs(nullptr),
+    m_slab_count(0)
+{
+    assert(m_slab_capacity > 0);
+}
+
+object_pool::~object_pool()
+{
+    // All objects must have been freed by now, so every remaining slab is
+    // in the free list.
+    while (mp_free_slabs)
+    {
+        slab* p = mp_free_slabs;
+        mp_free_slabs = p->next;
+        assert(!p->used);
+        ::operator delete(p, std::align_val_t(slab_size));
+    }
+}
+
+object_pool::slab* object_pool::create_slab()
+{
+    void* mem = ::operator new(slab_size, std::align_val_t(slab_size));
+    slab* p = static_cast<slab*>(mem);
+    p->prev = nullptr;
+    p->next = nullptr;
+    p->free_slots = nullptr;
+    p->used = 0;
+    p->touched = 0;
+    ++m_slab_count;
+    return p;
+}
+
+void object_pool::destroy_slab(slab* p)
+{
+    // Unlink it from the free list.
+    if (p->prev)
+        p->prev->next = p->next;
+    else
+        mp_free_slabs = p->next;
+
+    if (p->next)
+        p->next->prev = p->prev;
+
+    ::operator delete(p, std::align_val_t(slab_size));
+    --m_slab_count;
+}
+
+void* object_pool::allocate()
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+
+    if (!mp_free_slabs)
+        mp_free_slabs = create_slab();
+
+    slab* p = mp_free_slabs;
+
+    void* ret = nullptr;
+    if (p->free_slots)
+    {
+        ret = p->free_slots;
+        p->free_slots = *static_cast<void**>(ret);
+    }
+    else
+    {
+        assert(p->touched < m_slab_capacity);
+        ret = p->get_slot(p->touched++, m_object_size);
+    }
+
+    ++p->used;
+
+    if (p->used == m_slab_capacity)
+    {
+        // This slab is full.  Take it off the free list.
+        mp_free_slabs = p->next;
+        if (mp_free_slabs)
+            mp_free_slabs->prev = nullptr;
+
+        p->next = nullptr;
+    }
+
+    return ret;
+}
+
+void object_pool::deallocate(void* ptr)
+{
+    if (!ptr)
+        return;
+
+    uintptr_t addr = reinterpret_cast<uintptr_t>(ptr);
+    slab* p = reinterpret_cast<slab*>(addr & ~uintptr_t(slab_size - 1));
+
+    std::lock_guard<std::mutex> lock(m_mtx);
+
+    *static_cast<void**>(ptr) = p->free_slots;
+    p->free_slots = ptr;
+
+    if (p->used-- == m_slab_capacity)
+    {
+        // This slab was full.  Put it back in the free list.
+        p->prev = nullptr;
+        p->next = mp_free_slabs;
+        if (mp_free_slabs)
+            mp_free_slabs->prev = p;
+        mp_free_slabs = p;
+    }
+
+    if (!p->used && (p->prev || p->next))
+        // Return the slab to the system, unless it's the only slab left to
+        // allocate from.
+        destroy_slab(p);
+}
+
+size_t object_pool::get_slab_count()
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    return m_slab_count;
+}
+
+}
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
@@ -0,0 +1,75 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef INCLUDED_IXION_OBJECT_POOL_HPP
+#define INCLUDED_IXION_OBJECT_POOL_HPP
+
+#include <cstdlib>
+#include <mutex>
+
+namespace ixion {
+
+/**
+ * Allocator for objects of one fixed size.  The objects are carved out of
+ * large slabs, so that objects allocated one after another are placed next
+ * to each other in memory.  Freed objects are recycled, and a slab is
+ * returned to the system as soon as all objects in it have been freed,
+ * which happens in bulk when a whole sheet gets cleared.
+ *
+ * <p>All methods are thread-safe.</p>
+ */
+class object_pool
+{
+    struct slab;
+
+    const size_t m_object_size;
+    const size_t m_slab_capacity;
+
+    std::mutex m_mtx;
+
+    /** Linked list of slabs that have at least one free slot. */
+    slab* mp_free_slabs;
+
+    /** Number of slabs currently allocated, including full ones. */
+    size_t m_slab_count;
+
+    slab* create_slab();
+    void destroy_slab(slab* p);
+
+public:
+    object_pool(const object_pool&) = delete;
+    object_pool& operator= (const object_pool&) = delete;
+
+    explicit object_pool(size_t object_size);
+    ~object_pool();
+
+    void* allocate();
+    void deallocate(void* p);
+
+    /**
+     * @return number of slabs currently allocated.
+     */
+    size_t get_slab_count();
+
+    /**
+     * Get the pool instance for objects of a specified type.  The instance
+     * is never destroyed, so that objects may be freed during static
+     * destruction.
+     */
+    template<typename T>
+    static object_pool& get()
+    {
+        static object_pool* pool = new object_pool(sizeof(T));
+        return *pool;
+    }
+};
+
+}
+
+#endif
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
@@ -0,0 +1,186 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "object_pool.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <set>
+#include <vector>
+
+using namespace ixion;
+using namespace std;
+
+namespace {
+
+constexpr size_t object_size = 48;
+
+/**
+ * Allocate objects until the pool creates a new slab.  All objects but the
+ * last one are in the first slab, which is then full.
+ *
+ * @return allocated objects.
+ */
+std::vector<void*> fill_first_slab(object_pool& pool)
+{
+    assert(pool.get_slab_count() == 0);
+
+    std::vector<void*> objects;
+    while (pool.get_slab_count() < 2)
+    {
+        void* p = pool.allocate();
+        assert(p);
+        std::memset(p, 0xFF, object_size);
+        objects.push_back(p);
+    }
+
+    return objects;
+}
+
+void free_all(object_pool& pool, const std::vector<void*>& objects)
+{
+    for (void* p : objects)
+        pool.deallocate(p);
+}
+
+}
+
+void test_fill_past_capacity()
+{
+    cout << "--" << endl << __FUNCTION__ << endl;
+
+    object_pool pool(object_size);
+    std::vector<void*> objects = fill_first_slab(pool);
+    assert(objects.size() > 2);
+    assert(pool.get_slab_count() == 2);
+
+    // Every object must be distinct.
+    std::set<void*> unique(objects.begin(), objects.end());
+    assert(unique.size() == objects.size());
+
+    // The second slab takes more objects without creating another one.
+    size_t capacity = objects.size() - 1;
+    for (size_t i = 1; i < capacity; ++i)
+        objects.push_back(pool.allocate());
+
+    assert(pool.get_slab_count() == 2);
+
+    objects.push_back(pool.allocate());
+    assert(pool.get_slab_count() == 3);
+
+    free_all(pool, objects);
+    assert(pool.get_slab_count() == 1);
+}
+
+void test_free_from_full_slab()
+{
+    cout << "--" << endl << __FUNCTION__ << endl;
+
+    object_pool pool(object_size);
+    std::vector<void*> objects = fill_first_slab(pool);
+
+    // Freeing an object in the full slab puts that slab back in the free
+    // list, ahead of the second slab.  The next object then comes from it.
+    void* freed = objects[objects.size() / 2];
+    pool.deallocate(freed);
+    assert(pool.get_slab_count() == 2);
+
+    void* p = pool.allocate();
+    assert(p == freed);
+    assert(pool.get_slab_count() == 2);
+
+    // The first slab is full again, so the next object comes from the
+    // second slab.
+    p = pool.allocate();
+    assert(p != freed);
+    assert(pool.get_slab_count() == 2);
+    objects.push_back(p);
+
+    free_all(pool, objects);
+    assert(pool.get_slab_count() == 1);
+}
+
+void test_destroy_empty_slab()
+{
+    cout << "--" << endl << __FUNCTION__ << endl;
+
+    object_pool pool(object_size);
+    std::vector<void*> objects = fill_first_slab(pool);
+
+    // The last object is in the second slab, which takes a few more.
+    std::vector<void*> second{objects.back()};
+    objects.pop_back();
+    for (size_t i = 0; i < 3; ++i)
+        second.push_back(pool.allocate());
+
+    // Free an object in the first slab, which makes it the head of the free
+    // list.
+    pool.deallocate(objects.back());
+    objects.pop_back();
+    assert(pool.get_slab_count() == 2);
+
+    // Freeing every object in the second slab, which is not the head,
+    // destroys it.
+    free_all(pool, second);
+    assert(pool.get_slab_count() == 1);
+
+    // The remaining slab keeps serving objects.
+    objects.push_back(pool.allocate());
+    assert(pool.get_slab_count() == 1);
+
+    // The only slab left is kept even when all of its objects are freed.
+    free_all(pool, objects);
+    assert(pool.get_slab_count() == 1);
+}
+
+void test_reuse_freed_slots()
+{
+    cout << "--" << endl << __FUNCTION__ << endl;
+
+    object_pool pool(object_size);
+
+    std::vector<void*> objects;
+    for (size_t i = 0; i < 4; ++i)
+        objects.push_back(pool.allocate());
+
+    // A freed slot gets handed out again.
+    pool.deallocate(objects[1]);
+    void* p = pool.allocate();
+    assert(p == objects[1]);
+
+    // Freed slots get reused in the reverse order they were freed.
+    pool.deallocate(objects[0]);
+    pool.deallocate(objects[2]);
+    assert(pool.allocate() == objects[2]);
+    assert(pool.allocate() == objects[0]);
+
+    // Once the freed slots run out, untouched slots get used.
+    p = pool.allocate();
+    assert(std::find(objects.begin(), objects.end(), p) == objects.end());
+    objects.push_back(p);
+    assert(pool.get_slab_count() == 1);
+
+    free_all(pool, objects);
+
+    // Freeing a null pointer is a no-op.
+    pool.deallocate(nullptr);
+    assert(pool.get_slab_count() == 1);
+}
+
+int main()
+{
+    test_fill_past_capacity();
+    test_free_from_full_slab();
+    test_destroy_empty_slab();
+    test_reuse_freed_slots();
+
+    return EXIT_SUCCESS;
+}
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
@@ -0,0 +1,223 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "thread_pool.hpp"
+
+#include <cassert>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+
+#if !IXION_THREADS
+#error "This file is not to be compiled when the threads are disabled."
+#endif
+
+namespace ixion {
+
+namespace {
+
+struct task_queue
+{
+    std::mutex mtx;
+    std::deque<thread_pool::task_type> tasks;
+};
+
+/**
+ * Pool that owns the current worker thread, or nullptr if the current
+ * thread is not a worker thread.
+ */
+thread_local const void* tl_pool = nullptr;
+
+/** Index of the current worker thread within its pool. */
+thread_local size_t tl_worker = 0;
+
+}
+
+struct thread_pool::impl
+{
+    std::vector<std::unique_ptr<task_queue>> m_queues;
+    std::vector<std::thread> m_threads;
+
+    /** number of tasks currently sitting in the queues. */
+    std::atomic<size_t> m_queued;
+
+    /** number of tasks that have been pushed but not yet completed. */
+    std::atomic<size_t> m_pending;
+
+    /** number of worker threads that are sleeping or about to sleep. */
+    std::atomic<size_t> m_sleepers;
+
+    std::atomic<size_t> m_next_queue;
+
+    std::mutex m_mtx;
+    std::condition_variable m_cond_task;
+    std::condition_variable m_cond_done;
+    std::exception_ptr m_error;
+    bool m_stopping;
+
+    impl(size_t thread_count) :
+        m_queued(0), m_pending(0), m_sleepers(0), m_next_queue(0), m_stopping(false)
+    {
+        assert(thread_count > 0);
+
+        m_queues.reserve(thread_count);
+        for (size_t i = 0; i < thread_count; ++i)
+            m_queues.push_back(std::make_unique<task_queue>());
+
+        m_threads.reserve(thread_count);
+        for (size_t i = 0; i < thread_count; ++i)
+            m_threads.emplace_back(&thread_pool::impl::run_worker, this, i);
+    }
+
+    ~impl()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            m_stopping = true;
+        }
+
+        m_cond_task.notify_all();
+
+        for (std::thread& t : m_threads)
+            t.join();
+    }
+
+    void push(task_type task)
+    {
+        size_t index = (tl_pool == this) ? tl_worker : (m_next_queue++ % m_queues.size());
+
+        ++m_pending;
+
+        // Count the task before publishing it, so that a worker popping it
+        // right away never takes the count below zero.
+        ++m_queued;
+
+        {
+            task_queue& q = *m_queues[index];
+            std::lock_guard<std::mutex> lock(q.mtx);
+            q.tasks.push_back(std::move(task));
+        }
+
+        if (m_sleepers.load())
+        {
+            // Acquire the lock to make sure the sleeping worker is either
+            // already waiting, or has not yet checked for queued tasks.
+            std::lock_guard<std::mutex> lock(m_mtx);
+        }
+
+        m_cond_task.notify_one();
+    }
+
+    bool try_pop(size_t index, task_type& task)
+    {
+        for (size_t i = 0, n = m_queues.size(); i < n; ++i)
+        {
+            // Start with own queue, and move on to the other queues.
+            task_queue& q = *m_queues[(index + i) % n];
+            std::lock_guard<std::mutex> lock(q.mtx);
+            if (q.tasks.empty())
+                continue;
+
+            task = std::move(q.tasks.front());
+            q.tasks.pop_front();
+            --m_queued;
+            return true;
+        }
+
+        return false;
+    }
+
+    void execute(task_type& task)
+    {
+        try
+        {
+            task();
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            if (!m_error)
+                m_error = std::current_exception();
+        }
+
+        task = nullptr;
+
+        if (--m_pending == 0)
+        {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            m_cond_done.notify_all();
+        }
+    }
+
+    void run_worker(size_t index)
+    {
+        tl_pool = this;
+        tl_worker = index;
+
+        task_type task;
+
+        while (true)
+        {
+            if (try_pop(index, task))
+            {
+                execute(task);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(m_mtx);
+            ++m_sleepers;
+            m_cond_task.wait(lock, [this] { return m_stopping || m_queued.load() > 0; });
+            --m_sleepers;
+
+            if (m_stopping)
+                return;
+        }
+    }
+
+    void wait()
+    {
+        assert(tl_pool != this);
+
+        std::unique_lock<std::mutex> lock(m_mtx);
+        m_cond_done.wait(lock, [this] { return m_pending.load() == 0; });
+
+        if (m_error)
+        {
+            std::exception_ptr error = m_error;
+            m_error = nullptr;
+            std::rethrow_exception(error);
+        }
+    }
+};
+
+thread_pool::thread_pool(size_t thread_count) :
+    mp_impl(std::make_unique<impl>(thread_count)) {}
+
+thread_pool::~thread_pool() {}
+
+size_t thread_pool::size() const
+{
+    return mp_impl->m_threads.size();
+}
+
+void thread_pool::push(task_type task)
+{
+    mp_impl->push(std::move(task));
+}
+
+void thread_pool::wait()
+{
+    mp_impl->wait();
+}
+
+}
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
@@ -0,0 +1,86 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef INCLUDED_IXION_THREAD_POOL_HPP
+#define INCLUDED_IXION_THREAD_POOL_HPP
+
+#include "ixion/global.hpp"
+
+#include <memory>
+#include <functional>
+
+namespace ixion {
+
+/**
+ * Pool of worker threads that stay alive for the life time of the pool
+ * instance, so that the same threads can be reused across multiple
+ * calculation runs.  Each worker thread owns its own task queue.  A worker
+ * runs tasks from its own queue first, and steals tasks from other workers'
+ * queues when its own queue runs dry.
+ *
+ * Tasks in each queue are executed in the order they are pushed, and a
+ * stealing worker takes the oldest task from the victim's queue.  This
+ * guarantees that, when the tasks are pushed in topological order, a task
+ * that is waiting on the results of other tasks never prevents those tasks
+ * from being executed.
+ */
+class thread_pool
+{
+    struct impl;
+    std::unique_ptr<impl> mp_impl;
+
+public:
+    using task_type = std::function<void()>;
+
+    thread_pool() = delete;
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator= (const thread_pool&) = delete;
+
+    /**
+     * Constructor.
+     *
+     * @param thread_count number of worker threads to launch.  It must be
+     *                     greater than 0.
+     */
+    thread_pool(size_t thread_count);
+
+    /**
+     * Destructor.  It stops and joins all worker threads.  The workers
+     * execute any tasks still remaining in the queues before they exit.
+     */
+    ~thread_pool();
+
+    /**
+     * @return number of worker threads in the pool.
+     */
+    size_t size() const;
+
+    /**
+     * Push a new task to the pool.  When called from one of the worker
+     * threads, the task gets pushed to the queue owned by the calling
+     * worker.  Otherwise the tasks get distributed to the workers' queues in
+     * round-robin fashion.
+     *
+     * @param task task to execute.
+     */
+    void push(task_type task);
+
+    /**
+     * Wait until all pushed tasks have been executed.  If any of the tasks
+     * has thrown an exception, the first exception thrown gets re-thrown
+     * from this call.
+     *
+     * Note that this method must not be called from within a task.
+     */
+    void wait();
+};
+
+}
+
+#endif
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
@@ -35,6 +35,30 @@ rc_size_t& rc_size_t::operator= (const rc_size_t& other)
     return *this;
 }
 
+column_block_shape_t::column_block_shape_t() :
+    position(0), size(0), offset(0), type(column_block_t::unknown), data(nullptr) {}
+
+column_block_shape_t::column_block_shape_t(
+    std::size_t _position, std::size_t _size, std::size_t _offset,
+    column_block_t _type, const void* _data) :
+    position(_position), size(_size), offset(_offset), type(_type), data(_data) {}
+
+column_block_shape_t::column_block_shape_t(const column_block_shape_t& other) :
+    position(other.position), size(other.size), offset(other.offset),
+    type(other.type), data(other.data) {}
+
+column_block_shape_t::~column_block_shape_t() {}
+
+column_block_shape_t& column_block_shape_t::operator= (const column_block_shape_t& other)
+{
+    position = other.position;
+    size = other.size;
+    offset = other.offset;
+    type = other.type;
+    data = other.data;
+    return *this;
+}
+
 formula_group_t::formula_group_t() : size(), identity(0), grouped(false) {}
 formula_group_t::formula_group_t(const formula_group_t& r) :
     size(r.size), identity(r.identity), grouped(r.grouped) {}
@@ -35,6 +35,27 @@ celltype_t to_celltype(mdds::mtv::element_t mtv_type)
     throw general_error(os.str());
 }
 
+column_block_t to_column_block_type(mdds::mtv::element_t mtv_type)
+{
+    switch (mtv_type)
+    {
+        case element_type_empty:
+            return column_block_t::empty;
+        case element_type_numeric:
+            return column_block_t::numeric;
+        case element_type_boolean:
+            return column_block_t::boolean;
+        case element_type_string:
+            return column_block_t::string;
+        case element_type_formula:
+            return column_block_t::formula;
+        default:
+            ;
+    }
+
+    return column_block_t::unknown;
+}
+
 }}
 
 /* vim:set shiftwidth=4 softtabstop=4 expandtab: */
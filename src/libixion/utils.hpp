@@ -17,6 +17,8 @@ namespace ixion { namespace detail {
 
 celltype_t to_celltype(mdds::mtv::element_t mtv_type);
 
+column_block_t to_column_block_type(mdds::mtv::element_t mtv_type);
+
 template<std::size_t S, typename T>
 void ensure_max_size(const T& v)
 {
@@ -9,8 +9,79 @@
 
 #include "workbook.hpp"
 
+#include <algorithm>
+
 namespace ixion {
 
+formula_result_column::chunk::chunk() : rows(0)
+{
+    for (std::atomic<state_t>& state : states)
+        state.store(state_t::absent, std::memory_order_relaxed);
+}
+
+formula_result_column::formula_result_column() {}
+
+formula_result_column::~formula_result_column() {}
+
+void formula_result_column::clear(size_t row)
+{
+    size_t i = row / chunk_size;
+    if (i >= m_chunks.size())
+        m_chunks.resize(i + 1);
+
+    if (!m_chunks[i])
+        m_chunks[i] = std::make_unique<chunk>();
+
+    chunk& c = *m_chunks[i];
+    std::atomic<state_t>& state = c.states[row % chunk_size];
+    if (state.load(std::memory_order_relaxed) == state_t::absent)
+        ++c.rows;
+
+    state.store(state_t::unknown, std::memory_order_relaxed);
+}
+
+void formula_result_column::clear(size_t row1, size_t row2)
+{
+    if (m_chunks.empty())
+        return;
+
+    row2 = std::min(row2, m_chunks.size() * chunk_size - 1);
+
+    for (size_t row = row1; row <= row2; )
+    {
+        size_t i = row / chunk_size;
+        size_t end = std::min(row2 + 1, (i + 1) * chunk_size);
+
+        if (!m_chunks[i])
+        {
+            // No formula cells in this chunk.  Skip it in one step.
+            row = end;
+            continue;
+        }
+
+        chunk& c = *m_chunks[i];
+        for (; row < end; ++row)
+        {
+            std::atomic<state_t>& state = c.states[row % chunk_size];
+            if (state.load(std::memory_order_relaxed) == state_t::absent)
+                continue;
+
+            state.store(state_t::absent, std::memory_order_relaxed);
+            --c.rows;
+        }
+
+        if (!c.rows)
+            m_chunks[i].reset();
+    }
+
+    // Trim the released chunks at the end.
+    while (!m_chunks.empty() && !m_chunks.back())
+        m_chunks.pop_back();
+
+    if (m_chunks.empty())
+        m_chunks.shrink_to_fit();
+}
+
 worksheet::worksheet() {}
 
 worksheet::worksheet(size_t row_size, size_t col_size)
@@ -25,6 +96,39 @@ worksheet::worksheet(size_t row_size, size_t col_size)
 
 worksheet::~worksheet() {}
 
+const formula_result_column* worksheet::get_result_column(size_type n) const
+{
+    return n < m_result_columns.size() ? m_result_columns[n].get() : nullptr;
+}
+
+formula_result_column* worksheet::get_result_column(size_type n)
+{
+    return n < m_result_columns.size() ? m_result_columns[n].get() : nullptr;
+}
+
+formula_result_column& worksheet::fetch_result_column(size_type n)
+{
+    if (n >= m_result_columns.size())
+        m_result_columns.resize(n + 1);
+
+    if (!m_result_columns[n])
+        m_result_columns[n] = std::make_unique<formula_result_column>();
+
+    return *m_result_columns[n];
+}
+
+void worksheet::clear_results(size_type col, size_type row1, size_type row2)
+{
+    formula_result_column* p = get_result_column(col);
+    if (!p)
+        return;
+
+    p->clear(row1, row2);
+
+    if (p->empty())
+        m_result_columns[col].reset();
+}
+
 workbook::workbook() {}
 
 workbook::workbook(size_t sheet_size, size_t row_size, size_t col_size)
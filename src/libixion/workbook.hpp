@@ -11,10 +11,117 @@
 #include "column_store_type.hpp"
 #include "model_types.hpp"
 
+#include <atomic>
+#include <memory>
 #include <vector>
 
 namespace ixion {
 
+/**
+ * Copy of the results of the formula cells in one column, indexed by row.
+ * It allows range reads to access numeric formula results as contiguous
+ * arrays, as they do with numeric cells.  The formula cells still hold the
+ * authoritative results; a row whose state is unknown or absent must be
+ * read from its formula cell.
+ *
+ * <p>The results are stored in fixed-size chunks of rows, which get
+ * allocated only for the rows that have formula cells, and get released
+ * once none of their rows has a formula cell.</p>
+ *
+ * <p>The chunks are allocated in clear(size_t) and released in
+ * clear(size_t, size_t), neither of which may be called while a
+ * calculation is running on worker threads.  The other methods may be
+ * called concurrently for different rows.</p>
+ */
+class formula_result_column
+{
+public:
+    /**
+     * State of the result at a row.  A row is absent when it is not known
+     * to have a formula cell.
+     */
+    enum class state_t : uint8_t { absent, unknown, numeric, string, error };
+
+    /** Number of rows stored in each chunk. */
+    static constexpr size_t chunk_size = 1024;
+
+    formula_result_column();
+    ~formula_result_column();
+
+    /**
+     * @return true if no row has a formula cell, hence no storage is
+     *         allocated.
+     */
+    bool empty() const { return m_chunks.empty(); }
+
+    /**
+     * Mark the result at a row unknown, after the formula cell at that row
+     * has been reset.  It allocates the chunk covering the row if needed.
+     */
+    void clear(size_t row);
+
+    /**
+     * Mark the rows in a range absent, after the cells in that range have
+     * been modified.  The chunks left without any row that has a formula
+     * cell get released.
+     */
+    void clear(size_t row1, size_t row2);
+
+    void set_numeric(size_t row, double val)
+    {
+        chunk& c = *m_chunks[row / chunk_size];
+        c.values[row % chunk_size] = val;
+        c.states[row % chunk_size].store(state_t::numeric, std::memory_order_release);
+    }
+
+    void set_state(size_t row, state_t state)
+    {
+        m_chunks[row / chunk_size]->states[row % chunk_size].store(state, std::memory_order_release);
+    }
+
+    state_t get_state(size_t row) const
+    {
+        size_t i = row / chunk_size;
+        if (i >= m_chunks.size() || !m_chunks[i])
+            return state_t::absent;
+
+        return m_chunks[i]->states[row % chunk_size].load(std::memory_order_acquire);
+    }
+
+    /**
+     * @return pointer to the numeric result at a row.  The values of the
+     *         subsequent rows follow it, up to the number of rows returned by
+     *         get_contiguous_size().
+     */
+    const double* get_values(size_t row) const
+    {
+        return &m_chunks[row / chunk_size]->values[row % chunk_size];
+    }
+
+    /**
+     * @return number of rows, starting from the specified row, whose values
+     *         are stored contiguously.
+     */
+    static size_t get_contiguous_size(size_t row)
+    {
+        return chunk_size - row % chunk_size;
+    }
+
+private:
+    struct chunk
+    {
+        double values[chunk_size];
+        std::atomic<state_t> states[chunk_size];
+
+        /** Number of rows that are not absent. */
+        size_t rows;
+
+        chunk();
+    };
+
+    std::vector<std::unique_ptr<chunk>> m_chunks;
+};
+
 class worksheet
 {
 public:
@@ -44,9 +151,36 @@ public:
     detail::named_expressions_t& get_named_expressions() { return m_named_expressions; }
     const detail::named_expressions_t& get_named_expressions() const { return m_named_expressions; }
 
+    /**
+     * Get the result column of a column, if one exists.
+     *
+     * @param n column index.
+     *
+     * @return pointer to the result column, or nullptr if the column has no
+     *         result column.
+     */
+    const formula_result_column* get_result_column(size_type n) const;
+    formula_result_column* get_result_column(size_type n);
+
+    /**
+     * Get the result column of a column, creating one if it does not exist
+     * yet.
+     *
+     * @param n column index.
+     */
+    formula_result_column& fetch_result_column(size_type n);
+
+    /**
+     * Invalidate the results stored in the result column for a range of
+     * rows, after the cells in that range have been modified.  The result
+     * column gets released once it no longer stores any result.
+     */
+    void clear_results(size_type col, size_type row1, size_type row2);
+
 private:
     column_stores_t m_columns;
     std::vector<column_store_t::iterator> m_pos_hints;
+    std::vector<std::unique_ptr<formula_result_column>> m_result_columns;
     detail::named_expressions_t m_named_expressions;
 };
 
@@ -112,6 +112,25 @@ void print_section_title(const char* title)
     std::cout << detail::get_formula_result_output_separator() << std::endl << title << std::endl;
 }
 
+/**
+ * Keep the cell tracker in bulk-load mode for the lifetime of the
+ * instance, so that the mode ends even when an exception is thrown.
+ */
+class bulk_add_scope
+{
+    dirty_cell_tracker& m_tracker;
+public:
+    bulk_add_scope(dirty_cell_tracker& tracker) : m_tracker(tracker)
+    {
+        m_tracker.begin_bulk_add();
+    }
+
+    ~bulk_add_scope()
+    {
+        m_tracker.end_bulk_add();
+    }
+};
+
 namespace commands {
 
 enum class type
@@ -279,8 +298,12 @@ void model_parser::parse_command()
 
             // Perform full calculation on all currently stored formula cells.
 
-            for (const abs_range_t& pos : m_dirty_formula_cells)
-                register_formula_cell(m_context, pos.first);
+            // Register all formula cells in one go.
+            {
+                bulk_add_scope scope(m_context.get_cell_tracker());
+                for (const abs_range_t& pos : m_dirty_formula_cells)
+                    register_formula_cell(m_context, pos.first);
+            }
 
             abs_range_set_t empty;
             std::vector<abs_range_t> sorted_cells =
@@ -653,7 +676,7 @@ void model_parser::parse_result_cache()
                 throw model_parser::parse_error(name_s);
             }
 
-            fc->set_result_cache(fres);
+            fc->set_result_cache(m_context, pos, fres);
 
             cout << get_display_cell_string(pos) << ": " << fres.str(m_context) << endl;
             break;